@@ -0,0 +1,1291 @@
+#include "BaseUtil.h"
+#include "StrUtil.h"
+#include "FileUtil.h"
+#include "Vec.h"
+#include "UIMarkup.h"
+#include "UIAttributes.h"
+#include "UIBase.h"
+#include "UIFactory.h"
+#include "UIArena.h"
+#include "UIStringPool.h"
+#include "UIHitTest.h"
+#include "UIDirtyRegion.h"
+#include "UITimerWheel.h"
+#include "UINameIndex.h"
+#include <psapi.h>
+#include <malloc.h>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+
+// Compiles dialog markup into the binary image loaded by
+// CreateDialogFromCompiledFile(), meant to be run as a build step.
+// Files with .xml extension are parsed as xml, all others as simple markup.
+//
+// With -cpp it generates C++ code that builds the dialog with
+// DialogCodeBuilder, for dialogs that never change at runtime.
+//
+// With -bench it instead measures the speed of the markup parsers on
+// the given files or, without files, on synthetic dialogs, so that parser
+// regressions can be spotted before a release. Each parse is also done in
+// place and with the scalar scanner, and reports the most heap it held.
+// Without files it then times the other parts of building and running a
+// dialog that don't need a window: visiting nodes with a MarkupCursor,
+// resolving control classes in the registry, applying attributes, allocating controls from an arena,
+// interning strings in a StringPool, finding controls by name, hit testing,
+// merging dirty rects and firing timers from the timer wheel.
+
+static int Usage()
+{
+    fprintf(stderr, "usage: MarkupCompiler <dialog.xml|dialog.txt> <out-file>\n");
+    fprintf(stderr, "       MarkupCompiler -cpp <dialog.xml|dialog.txt> <out.cpp> <function-name>\n");
+    fprintf(stderr, "       MarkupCompiler -bench <iterations> [<dialog.xml|dialog.txt>...]\n");
+    return 1;
+}
+
+static bool IsXmlFile(const char *path)
+{
+    const char *ext = strrchr(path::GetBaseName(path), '.');
+    return ext && str::EqI(ext, ".xml");
+}
+
+static int Compile(const char *src, const char *dst)
+{
+    ScopedMem<char> markup(file::ReadAll(src, NULL));
+    if (!markup) {
+        fprintf(stderr, "couldn't read '%s'\n", src);
+        return 1;
+    }
+
+    size_t len;
+    bool isXml = IsXmlFile(src);
+    ScopedMem<char> image(isXml ? CompileMarkupXml(markup, &len) : CompileMarkupSimple(markup, &len));
+    if (!image) {
+        fprintf(stderr, "'%s' is not valid markup\n", src);
+        return 1;
+    }
+
+    if (!file::WriteAll(dst, image, len)) {
+        fprintf(stderr, "couldn't write '%s'\n", dst);
+        return 1;
+    }
+    return 0;
+}
+
+#define CONTROL_NAME(cls) #cls,
+static const char *gKnownControls[] = { KNOWN_CONTROLS(CONTROL_NAME) };
+#undef CONTROL_NAME
+
+static bool IsKnownControl(const char *name)
+{
+    for (size_t i = 0; i < dimof(gKnownControls); i++) {
+        if (str::Eq(gKnownControls[i], name))
+            return true;
+    }
+    return false;
+}
+
+// returns the name of the AttrId constant for an attribute name
+static const char *AttrIdConstant(const char *name)
+{
+#define ATTR_NAME_STR(id, name) name,
+    static const char *names[] = { ATTRIBUTES(ATTR_NAME_STR) };
+#undef ATTR_NAME_STR
+#define ATTR_CONSTANT(id, name) "ATTR_" #id,
+    static const char *constants[] = { ATTRIBUTES(ATTR_CONSTANT) };
+#undef ATTR_CONSTANT
+    for (size_t i = 0; i < dimof(names); i++) {
+        if (str::Eq(names[i], name))
+            return constants[i];
+    }
+    return "ATTR_UNKNOWN";
+}
+
+static void AppendCString(str::Str<char>& out, const char *s)
+{
+    out.Append('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        // escaping '?' avoids accidental trigraphs
+        if ('"' == c || '\\' == c || '?' == c) {
+            out.Append('\\');
+            out.Append((char)c);
+        } else if (c < ' ' || c >= 0x7f) {
+            out.AppendFmt("\\%03o", c);
+        } else {
+            out.Append((char)c);
+        }
+    }
+    out.Append('"');
+}
+
+// generates DialogCodeBuilder calls that mirror what the dialog
+// builder does for each node
+class CodeGenerator : public MarkupParserCallback {
+    int nodesCount;
+public:
+    str::Str<char> code;
+
+    CodeGenerator() : nodesCount(0) {}
+
+    virtual void NewNode(MarkupNode *node) {
+        MarkupNode *parent = node->Parent();
+        // the user field of nodes we've seen is their index
+        int parentIdx = parent ? (int)(size_t)parent->user : -1;
+        node->user = (void*)(size_t)nodesCount++;
+
+        // the builder skips the Dialog node if it's the first node
+        if (str::Eq(node->name, "Dialog") && !parent) {
+            code.Append("    b.Node(NULL, -1);\r\n");
+            return;
+        }
+        if (IsKnownControl(node->name)) {
+            code.AppendFmt("    b.Node(new %sUI, %d);\r\n", node->name, parentIdx);
+        } else {
+            code.Append("    b.CustomNode(");
+            AppendCString(code, node->name);
+            code.AppendFmt(", %d);\r\n", parentIdx);
+        }
+        for (size_t i = 0; i < node->AttributesCount(); i++) {
+            const char *name = node->AttributeName(i);
+            code.AppendFmt("    b.Attribute(%s, ", AttrIdConstant(name));
+            AppendCString(code, name);
+            code.Append(", ");
+            AppendCString(code, node->AttributeValue(i));
+            code.Append(");\r\n");
+        }
+    }
+};
+
+static int GenerateCode(const char *src, const char *dst, const char *funcName)
+{
+    ScopedMem<char> markup(file::ReadAll(src, NULL));
+    if (!markup) {
+        fprintf(stderr, "couldn't read '%s'\n", src);
+        return 1;
+    }
+
+    CodeGenerator gen;
+    bool ok = IsXmlFile(src) ? ParseMarkupXml(markup, &gen) : ParseMarkupSimple(markup, &gen);
+    if (!ok) {
+        fprintf(stderr, "'%s' is not valid markup\n", src);
+        return 1;
+    }
+
+    str::Str<char> out;
+    out.AppendFmt("// generated by MarkupCompiler from %s, do not edit\r\n", path::GetBaseName(src));
+    out.Append("#include \"UIlib.h\"\r\n\r\n");
+    out.AppendFmt("ControlUI *%s(IDialogBuilderCallback* cb)\r\n{\r\n", funcName);
+    out.Append("    DialogCodeBuilder b(cb);\r\n");
+    out.Append(gen.code.Get(), gen.code.Count());
+    out.Append("    return b.Finish();\r\n}\r\n");
+
+    if (!file::WriteAll(dst, out.Get(), out.Count())) {
+        fprintf(stderr, "couldn't write '%s'\n", dst);
+        return 1;
+    }
+    return 0;
+}
+
+class NodeCounter : public MarkupParserCallback {
+public:
+    size_t nodes;
+    NodeCounter() : nodes(0) {}
+    virtual void NewNode(MarkupNode *node) { nodes++; }
+};
+
+class AttributeCounter : public MarkupParserCallback {
+public:
+    size_t attributes;
+    AttributeCounter() : attributes(0) {}
+    virtual void NewNode(MarkupNode *node) { attributes += node->AttributesCount(); }
+};
+
+#ifdef _DEBUG
+// the debug crt lets us count allocations made by the parser
+static long gAllocsCount = 0;
+
+static int __cdecl CountAllocs(int allocType, void *, size_t, int, long, const unsigned char *, int)
+{
+    if (_HOOK_ALLOC == allocType || _HOOK_REALLOC == allocType)
+        gAllocsCount++;
+    return TRUE;
+}
+#endif
+
+// The allocation hook only exists in the debug crt. In release builds we
+// instead walk the heap at every node, which shows how many blocks the
+// parser holds on to, though not the ones it has freed since
+struct HeapUsage {
+    size_t  blocks;
+    size_t  bytes;
+};
+
+static HeapUsage GetHeapUsage()
+{
+    HeapUsage usage = { 0, 0 };
+    _HEAPINFO info;
+    info._pentry = NULL;
+    while (_HEAPOK == _heapwalk(&info)) {
+        if (_USEDENTRY == info._useflag) {
+            usage.blocks++;
+            usage.bytes += info._size;
+        }
+    }
+    return usage;
+}
+
+class HeapSampler : public MarkupParserCallback {
+public:
+    HeapUsage start, peak;
+    HeapSampler() { start = peak = GetHeapUsage(); }
+    virtual void NewNode(MarkupNode *node) {
+        HeapUsage usage = GetHeapUsage();
+        if (usage.blocks > peak.blocks)
+            peak.blocks = usage.blocks;
+        if (usage.bytes > peak.bytes)
+            peak.bytes = usage.bytes;
+    }
+};
+
+static double Seconds(LARGE_INTEGER& start, LARGE_INTEGER& end)
+{
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    double secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+    return secs > 0 ? secs : 1e-9;
+}
+
+static bool Parse(const char *markup, bool isXml, MarkupParserCallback *cb)
+{
+    if (isXml)
+        return ParseMarkupXml(markup, cb);
+    return ParseMarkupSimple(markup, cb);
+}
+
+// returns the time spent parsing, without the time spent refilling buf
+static double ParseInPlace(const char *markup, char *buf, size_t len, bool isXml, MarkupParserCallback *cb, int iterations, bool& ok)
+{
+    LARGE_INTEGER start, end;
+    double secs = 0;
+    for (int i = 0; i < iterations; i++) {
+        memcpy(buf, markup, len + 1);
+        QueryPerformanceCounter(&start);
+        if (isXml)
+            ok &= ParseMarkupXmlInPlace(buf, cb);
+        else
+            ok &= ParseMarkupSimpleInPlace(buf, cb);
+        QueryPerformanceCounter(&end);
+        secs += Seconds(start, end);
+    }
+    return secs;
+}
+
+// Parses markup as ParseMarkupXml()/ParseMarkupSimple() do, which copy it
+// first, in place, which doesn't, and with the scalar instead of the SSE2
+// scanning kernel
+static void Bench(const char *desc, const char *markup, bool isXml, int iterations)
+{
+    LARGE_INTEGER start, end;
+    NodeCounter counter;
+    bool ok = true;
+
+#ifdef _DEBUG
+    long allocsStart = gAllocsCount;
+#endif
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++)
+        ok &= Parse(markup, isXml, &counter);
+    QueryPerformanceCounter(&end);
+#ifdef _DEBUG
+    double allocs = (double)(gAllocsCount - allocsStart) / iterations;
+#endif
+    double secs = Seconds(start, end);
+
+    size_t len = str::Len(markup);
+    ScopedMem<char> buf(SAZA(char, len + 1));
+    NodeCounter inPlaceCounter;
+    double inPlaceSecs = ParseInPlace(markup, buf, len, isXml, &inPlaceCounter, iterations, ok);
+
+    NodeCounter scalarCounter;
+    bool hasSimd = UseSimdMarkupScan(false);
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++)
+        ok &= Parse(markup, isXml, &scalarCounter);
+    QueryPerformanceCounter(&end);
+    UseSimdMarkupScan(true);
+    double scalarSecs = Seconds(start, end);
+
+    // not timed, walking the heap is much slower than parsing
+    HeapSampler sampler;
+    Parse(markup, isXml, &sampler);
+
+    double mb = (double)len * iterations / (1024 * 1024);
+    printf("%-34s %s %9.2f MB/s %12.0f nodes/s, in place %9.2f MB/s %9d bytes not copied", desc,
+           isXml ? "xml   " : "simple", mb / secs, counter.nodes / secs, mb / inPlaceSecs, (int)(len + 1));
+    if (hasSimd)
+        printf(", scalar %9.2f MB/s", mb / scalarSecs);
+    printf(" %6d blocks %9.1f KB held", (int)(sampler.peak.blocks - sampler.start.blocks),
+           (sampler.peak.bytes - sampler.start.bytes) / 1024.0);
+#ifdef _DEBUG
+    printf(" %10.1f allocs", allocs);
+#endif
+    bool same = inPlaceCounter.nodes == counter.nodes && scalarCounter.nodes == counter.nodes;
+    printf("%s\n", ok && same ? "" : " (parse error)");
+}
+
+// A dialog with depth nested containers. The innermost has fanOut
+// children with attrsCount attributes each
+static char *GenerateXml(int depth, int fanOut, int attrsCount)
+{
+    str::Str<char> s;
+    for (int i = 0; i < depth; i++)
+        s.AppendFmt("%*s<VerticalLayout name=\"l%d\">\n", i * 2, "", i);
+    for (int i = 0; i < fanOut; i++) {
+        s.AppendFmt("%*s<Button", depth * 2, "");
+        for (int j = 0; j < attrsCount; j++)
+            s.AppendFmt(" a%d=\"value %d\"", j, i);
+        s.Append("/>\n");
+    }
+    for (int i = depth - 1; i >= 0; i--)
+        s.AppendFmt("%*s</VerticalLayout>\n", i * 2, "");
+    return s.StealData();
+}
+
+static char *GenerateSimple(int depth, int fanOut, int attrsCount)
+{
+    str::Str<char> s;
+    for (int i = 0; i < depth; i++)
+        s.AppendFmt("%*sVerticalLayout name=l%d\n", i * 2, "", i);
+    for (int i = 0; i < fanOut; i++) {
+        s.AppendFmt("%*sButton", depth * 2, "");
+        for (int j = 0; j < attrsCount; j++)
+            s.AppendFmt(" a%d='value %d'", j, i);
+        s.Append("\n");
+    }
+    return s.StealData();
+}
+
+// Repeat nodes that multiply into more work than the parser allows, none
+// of them producing any nodes, must be rejected right away instead of
+// hanging the parser
+static void BenchHostileMarkup()
+{
+    static const char *docs[] = {
+        "<Dialog><Repeat count=\"100000\"><Repeat count=\"100000\"><Repeat count=\"100000\"/></Repeat></Repeat></Dialog>",
+        "<Dialog><Template name=\"self\"><Repeat template=\"self\" count=\"2\"/></Template><Repeat template=\"self\" count=\"2\"/></Dialog>",
+        "Dialog\n  Repeat count=100000\n    Repeat count=100000\n      Repeat count=100000\n",
+    };
+    LARGE_INTEGER start, end;
+    int accepted = 0;
+    QueryPerformanceCounter(&start);
+    for (size_t i = 0; i < dimof(docs); i++) {
+        NodeCounter counter;
+        bool isXml = '<' == docs[i][0];
+        if (Parse(docs[i], isXml, &counter))
+            accepted++;
+    }
+    QueryPerformanceCounter(&end);
+    printf("hostile markup: %d documents rejected in %.1f ms%s\n", (int)dimof(docs) - accepted,
+           Seconds(start, end) * 1000, accepted ? " (some were accepted)" : "");
+}
+
+// Visits all nodes of a 1M-node document and their attributes with a
+// MarkupParserCallback and with a MarkupCursor (both including parsing)
+static void BenchCursor(int iterations)
+{
+    ScopedMem<char> xml(GenerateXml(8, 1000000, 2));
+    LARGE_INTEGER start, end;
+
+    AttributeCounter counter;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++)
+        ParseMarkupXml(xml, &counter);
+    QueryPerformanceCounter(&end);
+    double callbackSecs = Seconds(start, end) / iterations;
+
+    size_t attributes = 0;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        MarkupCursor cursor;
+        cursor.ParseXml(xml);
+        while (cursor.Next())
+            attributes += cursor.AttrCount();
+    }
+    QueryPerformanceCounter(&end);
+    double cursorSecs = Seconds(start, end) / iterations;
+
+    printf("1M nodes: callback %.3f s, cursor %.3f s%s\n", callbackSecs, cursorSecs,
+           attributes == counter.attributes ? "" : " (attributes differ)");
+}
+
+static ControlUI *CreateNothing() { return NULL; }
+
+// returns the time of a single lookup in ns
+static double BenchLookups(ControlFactoryRegistry& registry, const char **names, size_t count, int rounds)
+{
+    LARGE_INTEGER start, end;
+    size_t found = 0;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < rounds; i++) {
+        for (size_t j = 0; j < count; j++) {
+            if (registry.Find(names[j]))
+                found++;
+        }
+    }
+    QueryPerformanceCounter(&end);
+    if (found != count * rounds)
+        printf("(missing classes) ");
+    return Seconds(start, end) * 1e9 / ((double)count * rounds);
+}
+
+// Looks up the built-in classes in a registry that only has them and in
+// one with 500 more classes, the lookup time should be about the same
+static void BenchRegistry(int iterations)
+{
+    ControlFactoryRegistry builtIn, large;
+    for (size_t i = 0; i < dimof(gKnownControls); i++) {
+        builtIn.Register(gKnownControls[i], CreateNothing);
+        large.Register(gKnownControls[i], CreateNothing);
+    }
+    for (int i = 0; i < 500; i++) {
+        ScopedMem<char> cls(str::Format("CustomControl%d", i));
+        large.Register(cls, CreateNothing);
+    }
+
+    int rounds = iterations * 10000;
+    double builtInNs = BenchLookups(builtIn, gKnownControls, dimof(gKnownControls), rounds);
+    double largeNs = BenchLookups(large, gKnownControls, dimof(gKnownControls), rounds);
+    printf("control registry: %d classes %.1f ns/lookup, %d classes %.1f ns/lookup\n",
+           (int)builtIn.Count(), builtInNs, (int)large.Count(), largeNs);
+}
+
+// stand-ins for ControlUI, ContainerUI and ButtonUI with both ways of
+// applying attributes: SetAttributeByName() is the chain of string
+// compares the controls used to have at every level of the class
+// hierarchy, ApplyAttribute() switches on the id the builder resolved
+class BenchCtrl {
+public:
+    RECT            pos;
+    const char *    name;
+    const char *    text;
+    const char *    toolTip;
+    bool            enabled;
+    int             bgCol;
+    int             unknown;
+
+    BenchCtrl() : name(NULL), text(NULL), toolTip(NULL), enabled(true), bgCol(0), unknown(0) {}
+    virtual ~BenchCtrl() {}
+
+    virtual void SetAttributeByName(const char *name, const char *value) {
+        if (str::EqI(name, "pos"))           ParsePos(value);
+        else if (str::EqI(name, "name"))     this->name = value;
+        else if (str::EqI(name, "text"))     text = value;
+        else if (str::EqI(name, "tooltip"))  toolTip = value;
+        else if (str::EqI(name, "enabled"))  enabled = str::Eq(value, "true");
+        else if (str::EqI(name, "visible"))  enabled = str::Eq(value, "true");
+        else if (str::EqI(name, "shortcut")) enabled = value[0] != 0;
+        else if (str::EqI(name, "bgCol") || str::EqI(name, "backColor"))
+            bgCol = atoi(value);
+        else unknown++;
+    }
+
+    virtual void ApplyAttribute(AttrId id, const char *name, const char *value) {
+        switch (id) {
+        case ATTR_POS:       ParsePos(value); break;
+        case ATTR_NAME:      this->name = value; break;
+        case ATTR_TEXT:      text = value; break;
+        case ATTR_TOOLTIP:   toolTip = value; break;
+        case ATTR_ENABLED:
+        case ATTR_VISIBLE:   enabled = str::Eq(value, "true"); break;
+        case ATTR_SHORTCUT:  enabled = value[0] != 0; break;
+        case ATTR_BGCOL:
+        case ATTR_BACKCOLOR: bgCol = atoi(value); break;
+        default:             unknown++; break;
+        }
+    }
+
+    void ParsePos(const char *value) {
+        char *s = NULL;
+        pos.left = strtol(value, &s, 10);
+        pos.top = strtol(s + 1, &s, 10);
+        pos.right = strtol(s + 1, &s, 10);
+        pos.bottom = strtol(s + 1, &s, 10);
+    }
+};
+
+class BenchContainer : public BenchCtrl {
+public:
+    int     inset, padding, width, height;
+    bool    scrollbar;
+
+    virtual void SetAttributeByName(const char *name, const char *value) {
+        if (str::Eq(name, "inset"))                               inset = atoi(value);
+        else if (str::Eq(name, "padding"))                        padding = atoi(value);
+        else if (str::Eq(name, "width") || str::Eq(name, "dx"))   width = atoi(value);
+        else if (str::Eq(name, "height") || str::Eq(name, "dy"))  height = atoi(value);
+        else if (str::Eq(name, "scrollbar"))                      scrollbar = str::Eq(value, "true");
+        else BenchCtrl::SetAttributeByName(name, value);
+    }
+
+    virtual void ApplyAttribute(AttrId id, const char *name, const char *value) {
+        switch (id) {
+        case ATTR_INSET:     inset = atoi(value); break;
+        case ATTR_PADDING:   padding = atoi(value); break;
+        case ATTR_WIDTH:
+        case ATTR_DX:        width = atoi(value); break;
+        case ATTR_HEIGHT:
+        case ATTR_DY:        height = atoi(value); break;
+        case ATTR_SCROLLBAR: scrollbar = str::Eq(value, "true"); break;
+        default:             BenchCtrl::ApplyAttribute(id, name, value); break;
+        }
+    }
+};
+
+class BenchButton : public BenchCtrl {
+public:
+    int     align, textColor;
+
+    virtual void SetAttributeByName(const char *name, const char *value) {
+        if (str::Eq(name, "align"))           align = value[0];
+        else if (str::Eq(name, "textColor"))  textColor = atoi(value);
+        else BenchCtrl::SetAttributeByName(name, value);
+    }
+
+    virtual void ApplyAttribute(AttrId id, const char *name, const char *value) {
+        switch (id) {
+        case ATTR_ALIGN:     align = value[0]; break;
+        case ATTR_TEXTCOLOR: textColor = atoi(value); break;
+        default:             BenchCtrl::ApplyAttribute(id, name, value); break;
+        }
+    }
+};
+
+// Applies the attributes of a 100k-node dialog (1000 rows of 99 buttons)
+// by name and by id, including resolving each name with AttrIdFromName().
+// The markup is parsed once up front, so only the dispatch is timed
+static void BenchAttributes(int iterations)
+{
+    str::Str<char> xml;
+    xml.Append("<VerticalLayout name=\"root\" scrollbar=\"true\">\n");
+    for (int i = 0; i < 1000; i++) {
+        xml.AppendFmt("<HorizontalLayout name=\"row%d\" pos=\"0,%d,800,%d\" padding=\"2\" height=\"20\" bgCol=\"%d\">\n",
+                      i, i * 20, i * 20 + 20, i % 7);
+        for (int j = 0; j < 99; j++) {
+            xml.AppendFmt("<Button name=\"b%d_%d\" text=\"Item %d\" tooltip=\"Open item %d\" dx=\"8\" align=\"center\" textColor=\"%d\" data=\"%d\"/>\n",
+                          i, j, j, j, j % 5, j);
+        }
+        xml.Append("</HorizontalLayout>\n");
+    }
+    xml.Append("</VerticalLayout>\n");
+
+    MarkupCursor cursor;
+    cursor.ParseXml(xml.Get());
+    Vec<bool> isButton;
+    Vec<const char *> names, values;
+    Vec<size_t> attrsEnd;
+    while (cursor.Next()) {
+        isButton.Append(str::Eq(cursor.Name(), "Button"));
+        for (size_t i = 0; i < cursor.AttrCount(); i++) {
+            names.Append(cursor.AttrName(i));
+            values.Append(cursor.Attr(i));
+        }
+        attrsEnd.Append(names.Count());
+    }
+
+    BenchContainer container;
+    BenchButton button;
+    LARGE_INTEGER start, end;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        size_t a = 0;
+        for (size_t n = 0; n < attrsEnd.Count(); n++) {
+            BenchCtrl *ctrl = isButton.At(n) ? (BenchCtrl *)&button : &container;
+            for (; a < attrsEnd.At(n); a++)
+                ctrl->SetAttributeByName(names.At(a), values.At(a));
+        }
+    }
+    QueryPerformanceCounter(&end);
+    double byNameSecs = Seconds(start, end) / iterations;
+    int byNameUnknown = container.unknown + button.unknown;
+    container.unknown = button.unknown = 0;
+
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        size_t a = 0;
+        for (size_t n = 0; n < attrsEnd.Count(); n++) {
+            BenchCtrl *ctrl = isButton.At(n) ? (BenchCtrl *)&button : &container;
+            for (; a < attrsEnd.At(n); a++)
+                ctrl->ApplyAttribute(AttrIdFromName(names.At(a)), names.At(a), values.At(a));
+        }
+    }
+    QueryPerformanceCounter(&end);
+    double byIdSecs = Seconds(start, end) / iterations;
+    int byIdUnknown = container.unknown + button.unknown;
+
+    printf("%d nodes, %d attributes: by name %.2f ms %.1f ns/attr, by id %.2f ms %.1f ns/attr%s\n",
+           (int)attrsEnd.Count(), (int)names.Count(), byNameSecs * 1e3, byNameSecs * 1e9 / names.Count(),
+           byIdSecs * 1e3, byIdSecs * 1e9 / names.Count(), byNameUnknown == byIdUnknown ? "" : " (unknown attributes differ)");
+}
+
+// stand-in for a control: about the size of a ControlUI, with a name
+// allocated separately and a virtual destructor. It's allocated through
+// the same operator new/delete as ControlUI, so without a current arena
+// it comes from the heap exactly as a control would
+class BenchControl {
+public:
+    BenchControl *  parent;
+    char *          name;
+    int             value;
+    char            state[160];
+
+    BenchControl() : parent(NULL), name(NULL), value(0) {}
+    virtual ~BenchControl() { free(name); }
+
+    static void *operator new(size_t size) { return ControlArena::Alloc(size); }
+    static void operator delete(void *p) { ControlArena::Free(p); }
+};
+
+static void BenchControls(const char *desc, bool useArena, Vec<BenchControl*>& controls, size_t count, int iterations)
+{
+    LARGE_INTEGER start, end;
+    double createSecs = 0, traverseSecs = 0, deleteSecs = 0;
+    size_t ordered = 0;
+    for (int i = 0; i < iterations; i++) {
+        ControlArena *arena = useArena ? new ControlArena() : NULL;
+        QueryPerformanceCounter(&start);
+        {
+            ScopedControlArena scope(arena);
+            for (size_t j = 0; j < count; j++) {
+                BenchControl *c = new BenchControl;
+                c->parent = j > 0 ? controls.At((j - 1) / 8) : NULL;
+                c->name = str::Format("c%d", (int)j);
+                c->value = (int)j;
+                controls.Append(c);
+            }
+        }
+        QueryPerformanceCounter(&end);
+        createSecs += Seconds(start, end);
+
+        // a layout pass: every control looks at itself and its parent
+        QueryPerformanceCounter(&start);
+        for (size_t j = 0; j < count; j++) {
+            BenchControl *c = controls.At(j);
+            if (!c->parent || c->parent->value < c->value)
+                ordered++;
+        }
+        QueryPerformanceCounter(&end);
+        traverseSecs += Seconds(start, end);
+
+        QueryPerformanceCounter(&start);
+        for (size_t j = 0; j < count; j++)
+            delete controls.At(j);
+        if (arena)
+            arena->Release();
+        QueryPerformanceCounter(&end);
+        deleteSecs += Seconds(start, end);
+        controls.Reset();
+    }
+    printf("%d controls, %-5s: create %.3f s, traverse %.4f s, delete %.3f s%s\n", (int)count, desc,
+           createSecs / iterations, traverseSecs / iterations, deleteSecs / iterations,
+           ordered == count * iterations ? "" : " (broken tree)");
+}
+
+// Compares controls allocated one by one on the heap with controls of a
+// dialog allocated from a ControlArena, both through ControlArena::Alloc()
+// and ControlArena::Free() as ControlUI's operator new and delete do
+static void BenchArena(int iterations)
+{
+    Vec<BenchControl*> controls;
+    BenchControls("heap", false, controls, 100000, iterations);
+    BenchControls("arena", true, controls, 100000, iterations);
+}
+
+// Sets a unique name, one of 50 texts and one of 20 tooltips for each of
+// 100k controls (as a large list dialog would) and frees them, with a
+// copy per string and with a StringPool
+static void BenchStringPool(int iterations)
+{
+    const size_t count = 100000;
+    Vec<char*> names, texts, toolTips;
+    for (size_t i = 0; i < count; i++) {
+        names.Append(str::Format("item%d", (int)i));
+        texts.Append(str::Format("Label number %d", (int)(i % 50)));
+        toolTips.Append(str::Format("Click here to open item group %d", (int)(i % 20)));
+    }
+    const char **strings = SAZA(const char *, count * 3);
+    LARGE_INTEGER start, end;
+
+    size_t copiedBytes = 0;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < count; j++) {
+            strings[j * 3] = str::Dup(names.At(j));
+            strings[j * 3 + 1] = str::Dup(texts.At(j));
+            strings[j * 3 + 2] = str::Dup(toolTips.At(j));
+        }
+        copiedBytes = 0;
+        for (size_t j = 0; j < count * 3; j++) {
+            copiedBytes += str::Len(strings[j]) + 1;
+            free((void *)strings[j]);
+        }
+    }
+    QueryPerformanceCounter(&end);
+    double dupSecs = Seconds(start, end) / iterations;
+
+    size_t pooledBytes = 0;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        StringPool pool;
+        for (size_t j = 0; j < count; j++) {
+            strings[j * 3] = pool.Intern(names.At(j));
+            strings[j * 3 + 1] = pool.Intern(texts.At(j));
+            strings[j * 3 + 2] = pool.Intern(toolTips.At(j));
+        }
+        pooledBytes = pool.AllocatedBytes();
+        for (size_t j = 0; j < count * 3; j++)
+            pool.Release(strings[j]);
+    }
+    QueryPerformanceCounter(&end);
+    double poolSecs = Seconds(start, end) / iterations;
+
+    printf("100k controls' strings: copies %.3f s %.1f MB, pool %.3f s %.1f MB\n",
+           dupSecs, (double)copiedBytes / (1024 * 1024), poolSecs, (double)pooledBytes / (1024 * 1024));
+    free(strings);
+    FreeVecMembers(names);
+    FreeVecMembers(texts);
+    FreeVecMembers(toolTips);
+}
+
+// stands in for ControlUI, which can't be created without a window
+struct BenchNamed {
+    const char *    m_name;
+    BenchNamed *    m_nameNext;
+    BenchNamed *    m_namePrev;
+    bool            m_nameIndexed;
+};
+
+// Adds 1k to 1M named controls to a NameIndex, each followed by a lookup
+// of a control added earlier, as when controls are added to a live dialog
+// that's searched by name in between. The time per control should stay
+// the same at all sizes. Every lookup is checked, and so is that of
+// several controls with the same name the first one added is found
+static void BenchNameIndex(int iterations)
+{
+    const int maxCount = 1000000;
+    char *names = SAZA(char, maxCount * 12);
+    BenchNamed *objs = SAZA(BenchNamed, maxCount);
+    for (int i = 0; i < maxCount; i++) {
+        sprintf(names + i * 12, "ctrl%d", i);
+        objs[i].m_name = names + i * 12;
+    }
+
+    int wrong = 0;
+    srand(1);
+    printf("name index:");
+    for (int count = 1000; count <= maxCount; count *= 10) {
+        LARGE_INTEGER start, end;
+        double secs = 0;
+        for (int it = 0; it < iterations; it++) {
+            NameIndex<BenchNamed> index;
+            QueryPerformanceCounter(&start);
+            for (int i = 0; i < count; i++) {
+                index.Add(&objs[i]);
+                int j = (int)((((UINT)rand() << 15) ^ (UINT)rand()) % (UINT)(i + 1));
+                if (index.Find(objs[j].m_name) != &objs[j])
+                    wrong++;
+            }
+            QueryPerformanceCounter(&end);
+            secs += Seconds(start, end);
+            for (int i = 0; i < count; i++)
+                index.Remove(&objs[i]);
+            if (index.Count() != 0)
+                wrong++;
+        }
+        printf(" %dk %.1f ns", count / 1000, secs * 1e9 / ((double)count * iterations));
+    }
+
+    NameIndex<BenchNamed> dups;
+    BenchNamed same[3] = { 0 };
+    for (int i = 0; i < 3; i++) {
+        same[i].m_name = "same";
+        dups.Add(&same[i]);
+    }
+    if (dups.Find("same") != &same[0])
+        wrong++;
+    dups.Remove(&same[0]);
+    if (dups.Find("same") != &same[1])
+        wrong++;
+    dups.Remove(&same[2]);
+    dups.Add(&same[0]);
+    if (dups.Find("same") != &same[1])
+        wrong++;
+    printf(" per control%s\n", wrong ? " (wrong results)" : "");
+    free(names);
+    free(objs);
+}
+
+static RECT ClipRect(RECT rc, const RECT& clip)
+{
+    rc.left = max(rc.left, clip.left);
+    rc.top = max(rc.top, clip.top);
+    rc.right = min(rc.right, clip.right);
+    rc.bottom = min(rc.bottom, clip.bottom);
+    return rc;
+}
+
+// a mouse moving in straight strokes of a few pixels per WM_MOUSEMOVE
+// between random spots of the window
+static POINT *GenerateCursorTrace(int count, int dx, int dy)
+{
+    POINT *trace = SAZA(POINT, count);
+    POINT pt = { dx / 2, dy / 2 }, target = pt;
+    for (int i = 0; i < count; i++) {
+        if (pt.x == target.x && pt.y == target.y) {
+            target.x = rand() % dx;
+            target.y = rand() % dy;
+        }
+        int step = 1 + rand() % 4;
+        pt.x += min(max(target.x - pt.x, -step), step);
+        pt.y += min(max(target.y - pt.y, -step), step);
+        trace[i] = pt;
+    }
+    return trace;
+}
+
+// stands in for ControlUI in BenchHitTest(), which can't be created
+// without a window. Walk() and AddToGrid() do what FindControl() does in
+// ControlUI, ContainerUI and ListExpandElementUI
+struct HitNode {
+    RECT        rc;
+    // as returned by ControlUI::GetParent()
+    HitNode *   parent;
+    HitNode *   firstChild;
+    HitNode *   lastChild;
+    HitNode *   next;
+    bool        visible;
+    // for a ListExpandElementUI, its sub-item container. Its parent is the
+    // element's parent, as ListExpandElementUI::SetManager() makes it
+    HitNode *   expandContainer;
+};
+
+// all nodes are allocated up front, maxCount must be large enough
+class HitTree {
+    HitNode *   nodes;
+public:
+    size_t      count;
+
+    explicit HitTree(size_t maxCount) : count(0) { nodes = SAZA(HitNode, maxCount); }
+    ~HitTree() { free(nodes); }
+
+    HitNode *Add(HitNode *parent, int x, int y, int dx, int dy) {
+        HitNode *n = &nodes[count++];
+        n->rc.left = x;
+        n->rc.top = y;
+        n->rc.right = x + dx;
+        n->rc.bottom = y + dy;
+        n->parent = parent;
+        n->visible = true;
+        if (parent) {
+            if (parent->lastChild)
+                parent->lastChild->next = n;
+            else
+                parent->firstChild = n;
+            parent->lastChild = n;
+        }
+        return n;
+    }
+
+    // the sub-item container isn't one of the element's children
+    HitNode *AddExpandContainer(HitNode *element, int x, int y, int dx, int dy) {
+        HitNode *n = Add(NULL, x, y, dx, dy);
+        n->parent = element->parent;
+        element->expandContainer = n;
+        return n;
+    }
+};
+
+static bool PtInHitRect(const RECT& rc, POINT pt)
+{
+    return pt.x >= rc.left && pt.x < rc.right && pt.y >= rc.top && pt.y < rc.bottom;
+}
+
+// FindControl(__FindControlFromPoint, &pt, UIFIND_VISIBLE | UIFIND_HITTEST)
+static HitNode *Walk(HitNode *n, POINT pt)
+{
+    if (n->expandContainer) {
+        HitNode *found = Walk(n->expandContainer, pt);
+        if (found)
+            return found;
+    }
+    if (!n->visible || !PtInHitRect(n->rc, pt))
+        return NULL;
+    for (HitNode *c = n->firstChild; c; c = c->next) {
+        HitNode *found = Walk(c, pt);
+        if (found)
+            return found;
+    }
+    return n;
+}
+
+// FindControl(__AddToHitTest, grid, UIFIND_VISIBLE)
+static void AddToGrid(HitNode *n, HitTestGrid& grid)
+{
+    if (n->expandContainer)
+        AddToGrid(n->expandContainer, grid);
+    if (!n->visible)
+        return;
+    for (HitNode *c = n->firstChild; c; c = c->next)
+        AddToGrid(c, grid);
+    RECT rc = n->rc;
+    for (HitNode *p = n->parent; p; p = p->parent)
+        rc = ClipRect(rc, p->rc);
+    grid.Add((ControlUI *)n, rc);
+}
+
+// Hit tests random points on a 1920x1080 dashboard. A sidebar has a list
+// of 2000 rows scrolled by 600 pixels, where every 10th row is an expand
+// element and every other one of those is expanded. Next to it, 20
+// panels each have a nested container of 1000 controls, some of them
+// overlapping or sticking out of the container and a few hidden, and one
+// panel is hidden. Every answer of the grid is checked against a walk of
+// the tree, as FindControl() would do without the grid. Then it follows
+// a cursor trace, as WM_MOUSEMOVE would
+static void BenchHitTest(int iterations)
+{
+    const int panelCols = 5, panelRows = 4, itemCols = 40, itemRows = 25;
+    const int rowsCount = 2000, rowDy = 24, scrollY = 600;
+    HitTree tree(1 + 2 + rowsCount * 5 + panelCols * panelRows * (2 + itemCols * itemRows));
+    srand(1);
+    HitNode *root = tree.Add(NULL, 0, 0, 1920, 1080);
+    HitNode *sidebar = tree.Add(root, 0, 0, 320, 1080);
+    // its height is set once the rows are laid out
+    HitNode *list = tree.Add(sidebar, 0, -scrollY, 320, 0);
+    int y = -scrollY;
+    for (int i = 0; i < rowsCount; i++) {
+        bool expanded = i % 20 == 0;
+        int cy = expanded ? rowDy + 40 : rowDy;
+        HitNode *row = tree.Add(list, 0, y, 320, cy);
+        if (i % 10 == 0) {
+            // as ListExpandElementUI::SetPos() lays it out, which gives a
+            // collapsed element's container an empty rect. The sub-items
+            // are taller than the container
+            HitNode *sub = tree.AddExpandContainer(row, 14, y + rowDy, 320 - 8 - 14, cy - rowDy - 6);
+            for (int j = 0; j < 4; j++)
+                tree.Add(sub, 14 + j * 74, y + rowDy, 74, rowDy + 20);
+        }
+        y += cy;
+    }
+    list->rc.bottom = y;
+
+    int dx = (1920 - 320) / panelCols, dy = 1080 / panelRows;
+    for (int p = 0; p < panelCols * panelRows; p++) {
+        HitNode *panel = tree.Add(root, 320 + (p % panelCols) * dx, (p / panelCols) * dy, dx, dy);
+        panel->visible = p != 7;
+        HitNode *inner = tree.Add(panel, panel->rc.left + 4, panel->rc.top + 4, dx - 8, dy - 8);
+        for (int i = 0; i < itemCols * itemRows; i++) {
+            int cx = (dx - 8) / itemCols, cy = (dy - 8) / itemRows;
+            int x = inner->rc.left + (i % itemCols) * cx, y = inner->rc.top + (i / itemCols) * cy;
+            HitNode *item = tree.Add(inner, x, y, cx + rand() % (2 * cx), cy + rand() % (2 * cy));
+            item->visible = rand() % 100 != 0;
+        }
+    }
+
+    HitTestGrid grid;
+    LARGE_INTEGER start, end;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        grid.Reset();
+        AddToGrid(root, grid);
+        grid.Build();
+    }
+    QueryPerformanceCounter(&end);
+    double buildSecs = Seconds(start, end) / iterations;
+
+    const int queriesCount = 100000;
+    POINT *points = SAZA(POINT, queriesCount);
+    ControlUI **found = SAZA(ControlUI *, queriesCount);
+    for (int i = 0; i < queriesCount; i++) {
+        // a few points fall outside of the dialog
+        points[i].x = rand() % 2000 - 40;
+        points[i].y = rand() % 1160 - 40;
+    }
+
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        for (int j = 0; j < queriesCount; j++)
+            found[j] = grid.Find(points[j]);
+    }
+    QueryPerformanceCounter(&end);
+    double gridNs = Seconds(start, end) * 1e9 / ((double)queriesCount * iterations);
+
+    int mismatches = 0;
+    QueryPerformanceCounter(&start);
+    for (int j = 0; j < queriesCount; j++) {
+        if ((ControlUI *)Walk(root, points[j]) != found[j])
+            mismatches++;
+    }
+    QueryPerformanceCounter(&end);
+    double walkNs = Seconds(start, end) * 1e9 / queriesCount;
+
+    printf("hit test, %d controls: build %.3f ms, grid %.1f ns/point, tree walk %.1f ns/point%s\n",
+           (int)tree.count, buildSecs * 1000, gridNs, walkNs, mismatches ? " (results differ)" : "");
+
+    POINT *trace = GenerateCursorTrace(queriesCount, 1920, 1080);
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        for (int j = 0; j < queriesCount; j++)
+            found[j] = grid.Find(trace[j]);
+    }
+    QueryPerformanceCounter(&end);
+    double findNs = Seconds(start, end) * 1e9 / ((double)queriesCount * iterations);
+
+    printf("hit test, cursor trace: %.1f ns/move\n", findNs);
+    free(trace);
+    free(points);
+    free(found);
+}
+
+// Relayouts a 1920x1080 window with 10k controls: a sidebar with a 2000 row
+// scrolled list and a 4x2 grid of panels with 1000 controls each. As with
+// ControlUI::SetPos, each container is invalidated before its children.
+// Reports how many rects reach InvalidateRect() instead of 10k
+static void BenchDirtyRegion(int iterations)
+{
+    Vec<RECT> rects;
+    RECT sidebar = { 0, 0, 320, 1080 };
+    rects.Append(sidebar);
+    for (int i = 0; i < 2000; i++) {
+        RECT row = { 0, i * 24 - 480, 300, i * 24 - 456 };
+        rects.Append(row);
+    }
+    for (int p = 0; p < 8; p++) {
+        RECT panel = { 320 + (p % 4) * 400, (p / 4) * 540, 320 + (p % 4 + 1) * 400, (p / 4 + 1) * 540 };
+        rects.Append(panel);
+        for (int i = 0; i < 1000; i++) {
+            RECT rc = { panel.left + (i % 20) * 20, panel.top + (i / 20) * 10, 0, 0 };
+            rc.right = rc.left + 18;
+            rc.bottom = rc.top + 9;
+            rects.Append(rc);
+        }
+    }
+
+    DirtyRegion region;
+    LARGE_INTEGER start, end;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < iterations; i++) {
+        region.Reset();
+        for (size_t j = 0; j < rects.Count(); j++)
+            region.Add(rects.At(j));
+    }
+    QueryPerformanceCounter(&end);
+    double addNs = Seconds(start, end) * 1e9 / ((double)rects.Count() * iterations);
+
+    // the rows scrolled out of view don't count, Windows clips them away
+    RECT window = { 0, 0, 1920, 1080 };
+    INT64 area = 0;
+    for (size_t i = 0; i < region.Count(); i++) {
+        RECT rc = ClipRect(region.At(i), window);
+        if (rc.right > rc.left && rc.bottom > rc.top)
+            area += (INT64)(rc.right - rc.left) * (rc.bottom - rc.top);
+    }
+    printf("relayout of %d controls: %d rects to invalidate, %.1f ns/rect, %.0f%% of the window\n",
+           (int)rects.Count(), (int)region.Count(), addNs, 100.0 * area / (1920 * 1080));
+}
+
+struct TimerBenchState {
+    UINT    now;
+    UINT *  intervals;
+    UINT *  expected;
+    bool *  killed;
+    int     fires;
+    int     early;
+    int     late;
+    int     afterKill;
+    UINT    lastStep;
+};
+
+// each fake control has two timers, ids 0 and 1
+static ControlUI *TimerOwner(int i)
+{
+    return (ControlUI *)(size_t)(i / 2 + 1);
+}
+
+static void OnBenchTimer(ControlUI *ctrl, UINT id, void *data)
+{
+    TimerBenchState *s = (TimerBenchState *)data;
+    size_t i = ((size_t)ctrl - 1) * 2 + id;
+    s->fires++;
+    if (s->killed[i])
+        s->afterKill++;
+    else if ((int)(s->now - s->expected[i]) < 0)
+        s->early++;
+    else if ((int)(s->now - s->expected[i]) >= (int)s->lastStep)
+        s->late++;
+    s->expected[i] = s->now + s->intervals[i];
+}
+
+// Runs 100k timers with intervals between 16 ms and 5 s for a minute of a
+// virtual clock that wraps around midway, advanced by 1 to 16 ms as
+// WM_TIMER would. A tenth of the timers are killed and restarted along the
+// way. Each fire is checked to be neither early nor later than the step
+// it was due in, and the cost is compared with finding the timer by a
+// linear scan as PaintManagerUI used to do. At the end the timers are
+// removed with KillAll(), as when their controls are deleted
+static void BenchTimerWheel(int iterations)
+{
+    const int timersCount = 100000;
+    const UINT typical[] = { 16, 33, 50, 100, 250, 500, 1000, 5000 };
+    TimerBenchState s = { 0 };
+    s.intervals = SAZA(UINT, timersCount);
+    s.expected = SAZA(UINT, timersCount);
+    s.killed = SAZA(bool, timersCount);
+    srand(1);
+    for (int i = 0; i < timersCount; i++)
+        s.intervals[i] = typical[rand() % dimof(typical)] + rand() % 8;
+
+    double setNs = 0, killNs = 0, advanceSecs = 0;
+    int batches = 0;
+    size_t left = 0;
+    LARGE_INTEGER start, end;
+    for (int it = 0; it < iterations; it++) {
+        s.now = 0xffffffff - 30000;
+        TimerWheel wheel(s.now);
+        QueryPerformanceCounter(&start);
+        for (int i = 0; i < timersCount; i++)
+            wheel.Set(TimerOwner(i), i % 2, s.intervals[i], s.now);
+        QueryPerformanceCounter(&end);
+        setNs += Seconds(start, end) * 1e9 / timersCount;
+        for (int i = 0; i < timersCount; i++) {
+            s.expected[i] = s.now + s.intervals[i];
+            s.killed[i] = false;
+        }
+
+        for (UINT elapsed = 0; elapsed < 60000; ) {
+            s.lastStep = 1 + rand() % 16;
+            elapsed += s.lastStep;
+            s.now += s.lastStep;
+            QueryPerformanceCounter(&start);
+            wheel.Advance(s.now, OnBenchTimer, &s);
+            QueryPerformanceCounter(&end);
+            advanceSecs += Seconds(start, end);
+            // every second, kill 10k timers and restart those killed before
+            if (elapsed % 1000 < s.lastStep) {
+                int first = (elapsed / 1000 % 10) * (timersCount / 10);
+                QueryPerformanceCounter(&start);
+                for (int i = first; i < first + timersCount / 10; i++) {
+                    if (s.killed[i]) {
+                        wheel.Set(TimerOwner(i), i % 2, s.intervals[i], s.now);
+                        s.expected[i] = s.now + s.intervals[i];
+                    } else {
+                        wheel.Kill(TimerOwner(i), i % 2);
+                    }
+                    s.killed[i] = !s.killed[i];
+                }
+                QueryPerformanceCounter(&end);
+                killNs += Seconds(start, end) * 1e9 / (timersCount / 10);
+                batches++;
+            }
+        }
+        for (int i = 0; i < timersCount; i++) {
+            if (!s.killed[i] && (int)(s.now - s.expected[i]) >= 0)
+                s.late++;
+        }
+        for (int i = 0; i < timersCount; i += 2)
+            wheel.KillAll(TimerOwner(i));
+        left += wheel.Count();
+    }
+
+    // the old WM_TIMER handler looked at every timer until it found the one
+    Vec<UINT> scanIds;
+    for (int i = 0; i < timersCount; i++)
+        scanIds.Append(i);
+    const int lookups = 1000;
+    int misses = 0;
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < lookups; i++) {
+        UINT id = (UINT)(rand() % timersCount);
+        size_t j = 0;
+        while (j < scanIds.Count() && scanIds.At(j) != id)
+            j++;
+        if (j == scanIds.Count())
+            misses++;
+    }
+    QueryPerformanceCounter(&end);
+    double scanNs = Seconds(start, end) * 1e9 / lookups;
+
+    printf("%d timers: set %.1f ns, kill/restart %.1f ns, %.1f ns/fire, scan %.0f ns/fire%s\n",
+           timersCount, setNs / iterations, killNs / batches, advanceSecs * 1e9 / s.fires, scanNs,
+           misses ? " (scan failed)" : "");
+    printf("timers fired %d times: %d early, %d late, %d after being killed, %d left after KillAll()\n",
+           s.fires, s.early, s.late, s.afterKill, (int)left);
+    free(s.intervals);
+    free(s.expected);
+    free(s.killed);
+}
+
+static int RunBenchmarks(int iterations, char **files, int filesCount)
+{
+#ifdef _DEBUG
+    _CrtSetAllocHook(CountAllocs);
+#endif
+    for (int i = 0; i < filesCount; i++) {
+        ScopedMem<char> markup(file::ReadAll(files[i], NULL));
+        if (!markup) {
+            fprintf(stderr, "couldn't read '%s'\n", files[i]);
+            return 1;
+        }
+        Bench(path::GetBaseName(files[i]), markup, IsXmlFile(files[i]), iterations);
+    }
+
+    if (0 == filesCount) {
+        static const int depths[] = { 1, 8, 64 };
+        static const int fanOuts[] = { 10, 1000, 100000 };
+        static const int attrsCounts[] = { 0, 2, 8 };
+        for (size_t d = 0; d < dimof(depths); d++) {
+            for (size_t f = 0; f < dimof(fanOuts); f++) {
+                for (size_t a = 0; a < dimof(attrsCounts); a++) {
+                    ScopedMem<char> desc(str::Format("depth %d, fan-out %d, %d attrs", depths[d], fanOuts[f], attrsCounts[a]));
+                    ScopedMem<char> xml(GenerateXml(depths[d], fanOuts[f], attrsCounts[a]));
+                    Bench(desc, xml, true, iterations);
+                    ScopedMem<char> simple(GenerateSimple(depths[d], fanOuts[f], attrsCounts[a]));
+                    Bench(desc, simple, false, iterations);
+                }
+            }
+        }
+        BenchHostileMarkup();
+        BenchCursor(iterations);
+        BenchRegistry(iterations);
+        BenchAttributes(iterations);
+        BenchArena(iterations);
+        BenchStringPool(iterations);
+        BenchNameIndex(iterations);
+        BenchHitTest(iterations);
+        BenchDirtyRegion(iterations);
+        BenchTimerWheel(iterations);
+    }
+
+#ifdef _DEBUG
+    _CrtSetAllocHook(NULL);
+#endif
+    PROCESS_MEMORY_COUNTERS mem;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &mem, sizeof(mem)))
+        printf("peak working set: %.1f MB\n", (double)mem.PeakWorkingSetSize / (1024 * 1024));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && str::Eq(argv[1], "-bench")) {
+        int iterations = atoi(argv[2]);
+        if (iterations <= 0)
+            return Usage();
+        return RunBenchmarks(iterations, argv + 3, argc - 3);
+    }
+    if (5 == argc && str::Eq(argv[1], "-cpp"))
+        return GenerateCode(argv[2], argv[3], argv[4]);
+
+    if (argc != 3)
+        return Usage();
+    return Compile(argv[1], argv[2]);
+}
@@ -3,6 +3,9 @@
 #include <exdisp.h>
 #include <comdef.h>
 
+// pages are created over and over from the same markup
+static DialogTemplateCache gDialogTemplates;
+
 UINT StandardPageWnd::GetClassStyle() const 
 { 
     return UI_CLASSSTYLE_CHILD; 
@@ -20,10 +23,10 @@ LRESULT StandardPageWnd::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
         ControlUI* root;
         const char *s = GetDialogResourceSimple();
         if (s) {
-            root = CreateDialogFromSimple(s);
+            root = gDialogTemplates.CreateFromSimple(s);
         } else {
             s = GetDialogResourceXml();
-            root = CreateDialogFromXml(s);
+            root = gDialogTemplates.CreateFromXml(s);
         }
         ASSERT(root && "Failed to parse XML");
         m_pm.AttachDialog(root);
@@ -851,6 +851,7 @@ void ActiveXUI::SetPos(RECT rc)
     if (m_ctrl == NULL)  return;
 
     m_rcItem = rc;
+    m_mgr->InvalidateHitTest();
 
     SIZEL hmSize = { 0 };
     SIZEL pxSize = { 0 };
@@ -880,15 +881,16 @@ void ActiveXUI::DoPaint(HDC hDC, const RECT& /*rcPaint*/)
     }
 }
 
-void ActiveXUI::SetAttribute(const char* name, const char* value)
+void ActiveXUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (str::Eq(name, "clsid"))  CreateControl(value);
-    else if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else if (ParseHeight(name, value, n))
-        SetHeight(n);
-    else ControlUI::SetAttribute(name, value);
+    switch (id) {
+    case ATTR_CLSID:  CreateControl(value); break;
+    case ATTR_WIDTH:
+    case ATTR_DX:     SetWidth(atoi(value)); break;
+    case ATTR_HEIGHT:
+    case ATTR_DY:     SetHeight(atoi(value)); break;
+    default:          ControlUI::ApplyAttribute(id, name, value);
+    }
 }
 
 LRESULT ActiveXUI::MessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam, bool& bHandled)
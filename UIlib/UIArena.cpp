@@ -0,0 +1,84 @@
+#include "UIArena.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+// every allocation is preceded by the arena it came from (NULL for the
+// heap), padded to keep the object aligned as malloc() would
+#define ALLOC_HEADER_SIZE 16
+// the allocations in a block are aligned like the block itself
+#define BLOCK_DATA_OFFSET ((sizeof(Block) + ALLOC_HEADER_SIZE - 1) & ~(size_t)(ALLOC_HEADER_SIZE - 1))
+
+struct ControlArena::Block {
+    Block * next;
+    size_t  size;
+    size_t  used;
+};
+
+ControlArena *ControlArena::current = NULL;
+
+ControlArena::ControlArena() : blocks(NULL), refs(1)
+{
+}
+
+ControlArena::~ControlArena()
+{
+    while (blocks) {
+        Block *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+}
+
+void ControlArena::Release()
+{
+    Unref();
+}
+
+void ControlArena::Unref()
+{
+    if (0 == --refs)
+        delete this;
+}
+
+void *ControlArena::AllocBlock(size_t size)
+{
+    size = (size + ALLOC_HEADER_SIZE - 1) & ~(size_t)(ALLOC_HEADER_SIZE - 1);
+    if (!blocks || blocks->size - blocks->used < size) {
+        size_t blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        Block *b = (Block *)malloc(BLOCK_DATA_OFFSET + blockSize);
+        if (!b)
+            return NULL;
+        b->next = blocks;
+        b->size = blockSize;
+        b->used = 0;
+        blocks = b;
+    }
+    char *p = (char *)blocks + BLOCK_DATA_OFFSET + blocks->used;
+    blocks->used += size;
+    refs++;
+    return p;
+}
+
+void *ControlArena::Alloc(size_t size)
+{
+    char *p;
+    if (current)
+        p = (char *)current->AllocBlock(ALLOC_HEADER_SIZE + size);
+    else
+        p = (char *)malloc(ALLOC_HEADER_SIZE + size);
+    if (!p)
+        return NULL;
+    *(ControlArena **)p = current;
+    return p + ALLOC_HEADER_SIZE;
+}
+
+void ControlArena::Free(void *p)
+{
+    if (!p)
+        return;
+    char *start = (char *)p - ALLOC_HEADER_SIZE;
+    ControlArena *arena = *(ControlArena **)start;
+    if (arena)
+        arena->Unref();
+    else
+        free(start);
+}
@@ -0,0 +1,46 @@
+#ifndef UIArena_h
+#define UIArena_h
+
+#include "BaseUtil.h"
+
+// Memory for the controls of a dialog. Controls created while an arena is
+// current (see ScopedControlArena) are carved out of a few large blocks
+// instead of being separate heap allocations, which keeps a dialog's
+// controls close together in memory. Deleting such a control still runs
+// its destructor but doesn't free anything, the blocks are freed at once
+// when the last control is deleted and the creator has called Release().
+//   ControlArena *arena = new ControlArena();
+//   { ScopedControlArena scope(arena); root = CreateDialogFromXml(xml); }
+//   arena->Release();
+class ControlArena {
+    struct Block;
+
+    Block *     blocks;
+    // the creator's reference plus one per live object
+    size_t      refs;
+
+    ~ControlArena();
+    void *AllocBlock(size_t size);
+    void Unref();
+
+    friend class ScopedControlArena;
+    static ControlArena *current;
+public:
+    ControlArena();
+    void Release();
+
+    // from the current arena if there's one, otherwise from the heap
+    static void *Alloc(size_t size);
+    static void Free(void *p);
+};
+
+class ScopedControlArena {
+    ControlArena *prev;
+public:
+    explicit ScopedControlArena(ControlArena *arena) : prev(ControlArena::current) {
+        ControlArena::current = arena;
+    }
+    ~ScopedControlArena() { ControlArena::current = prev; }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "UIAttributes.h"
+#include "StrUtil.h"
+#include <ctype.h>
+
+#define ATTR_STR(id, name) name,
+static const char *gAttrNames[] = {
+    NULL,
+    ATTRIBUTES(ATTR_STR)
+};
+#undef ATTR_STR
+
+CASSERT(dimof(gAttrNames) == ATTR_COUNT, attr_names_match_attr_ids);
+
+const char *AttrName(AttrId id)
+{
+    if (id <= ATTR_UNKNOWN || id >= ATTR_COUNT)
+        return NULL;
+    return gAttrNames[id];
+}
+
+// A perfect hash of the names in ATTRIBUTES: length, first and last
+// character select at most one candidate, which is compared once.
+// Must be updated when adding attributes, AttrIdFromName() checks that
+// in debug builds.
+static AttrId LookupAttrId(const char *name, bool ignoreCase)
+{
+    size_t len = str::Len(name);
+    if (len < 2)
+        return ATTR_UNKNOWN;
+    char first = (char)tolower(name[0]);
+    char last = (char)tolower(name[len - 1]);
+
+    AttrId id = ATTR_UNKNOWN;
+    switch (len) {
+    case 2:
+        if ('d' == first)
+            id = ('x' == last) ? ATTR_DX : ATTR_DY;
+        break;
+    case 3:
+        id = ATTR_POS;
+        break;
+    case 4:
+        if ('l' == first)       id = ATTR_LAZY;
+        else if ('n' == first)  id = ATTR_NAME;
+        else if ('t' == first)  id = ('t' == last) ? ATTR_TEXT : ATTR_TYPE;
+        break;
+    case 5:
+        switch (first) {
+        case 'a': id = ATTR_ALIGN; break;
+        case 'b': id = ATTR_BGCOL; break;
+        case 'c': id = ATTR_CLSID; break;
+        case 'i': id = ('t' == last) ? ATTR_INSET : ATTR_IMAGE; break;
+        case 'l': id = ATTR_LAYER; break;
+        case 'w': id = ATTR_WIDTH; break;
+        }
+        break;
+    case 6:
+        switch (first) {
+        case 'f': id = ATTR_FOOTER; break;
+        case 'h': id = ('t' == last) ? ATTR_HEIGHT : ATTR_HEADER; break;
+        case 's': id = ATTR_SELECT; break;
+        }
+        break;
+    case 7:
+        switch (first) {
+        case 'e': id = ATTR_ENABLED; break;
+        case 'p': id = ATTR_PADDING; break;
+        case 's': id = ATTR_STRETCH; break;
+        case 't': id = ATTR_TOOLTIP; break;
+        case 'v': id = ATTR_VISIBLE; break;
+        }
+        break;
+    case 8:
+        if ('s' == first)
+            id = ('t' == last) ? ATTR_SHORTCUT : ATTR_SELECTED;
+        break;
+    case 9:
+        switch (first) {
+        case 'b': id = ATTR_BACKCOLOR; break;
+        case 'e': id = ATTR_EXPANDING; break;
+        case 's': id = ATTR_SCROLLBAR; break;
+        case 't': id = ATTR_TEXTCOLOR; break;
+        case 'w': id = ATTR_WATERMARK; break;
+        }
+        break;
+    }
+
+    if (ATTR_UNKNOWN == id)
+        return ATTR_UNKNOWN;
+    const char *s = gAttrNames[id];
+    bool same = ignoreCase ? str::EqI(name, s) : str::Eq(name, s);
+    return same ? id : ATTR_UNKNOWN;
+}
+
+#ifdef _DEBUG
+static bool AllAttrNamesHashed()
+{
+    for (int id = ATTR_UNKNOWN + 1; id < ATTR_COUNT; id++) {
+        if (LookupAttrId(gAttrNames[id], false) != id)
+            return false;
+    }
+    return true;
+}
+#endif
+
+AttrId AttrIdFromName(const char *name, bool ignoreCase)
+{
+#ifdef _DEBUG
+    static bool checked = false;
+    if (!checked) {
+        checked = true;
+        ASSERT(AllAttrNamesHashed());
+    }
+#endif
+    return LookupAttrId(name, ignoreCase);
+}
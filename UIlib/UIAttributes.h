@@ -0,0 +1,54 @@
+#ifndef UIAttributes_h
+#define UIAttributes_h
+
+#include "BaseUtil.h"
+
+// all attribute names known to the built-in controls. Resolving a name
+// to an id once lets controls dispatch with a switch instead of
+// comparing strings at every level of the class hierarchy.
+// AttrIdFromName() has to be updated when adding names
+#define ATTRIBUTES(V) \
+    V(POS,        "pos") \
+    V(NAME,       "name") \
+    V(TEXT,       "text") \
+    V(TOOLTIP,    "tooltip") \
+    V(ENABLED,    "enabled") \
+    V(VISIBLE,    "visible") \
+    V(SHORTCUT,   "shortcut") \
+    V(BGCOL,      "bgCol") \
+    V(BACKCOLOR,  "backColor") \
+    V(INSET,      "inset") \
+    V(PADDING,    "padding") \
+    V(WIDTH,      "width") \
+    V(DX,         "dx") \
+    V(HEIGHT,     "height") \
+    V(DY,         "dy") \
+    V(SCROLLBAR,  "scrollbar") \
+    V(CLSID,      "clsid") \
+    V(ALIGN,      "align") \
+    V(SELECTED,   "selected") \
+    V(SELECT,     "select") \
+    V(WATERMARK,  "watermark") \
+    V(HEADER,     "header") \
+    V(FOOTER,     "footer") \
+    V(EXPANDING,  "expanding") \
+    V(IMAGE,      "image") \
+    V(TEXTCOLOR,  "textColor") \
+    V(TYPE,       "type") \
+    V(STRETCH,    "stretch") \
+    V(LAZY,       "lazy") \
+    V(LAYER,      "layer")
+
+#define ATTR_ENUM(id, name) ATTR_##id,
+enum AttrId {
+    ATTR_UNKNOWN = 0,
+    ATTRIBUTES(ATTR_ENUM)
+    ATTR_COUNT
+};
+#undef ATTR_ENUM
+
+// returns ATTR_UNKNOWN for names that aren't in ATTRIBUTES
+AttrId      AttrIdFromName(const char *name, bool ignoreCase=false);
+const char *AttrName(AttrId id);
+
+#endif
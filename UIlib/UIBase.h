@@ -5,6 +5,7 @@
 #include "StrUtil.h"
 #include "FileUtil.h"
 #include "Vec.h"
+#include "UIAttributes.h"
 
 class PaintManagerUI;
 
@@ -239,8 +240,19 @@ protected:
     char  m_buf[MAX_LOCAL_STRING_LEN + 1];
 };
 
-bool ParseInt(const char *name, const char *val, const char *expectedName, int& ret);
-bool ParseWidth(const char *name, const char *val, int& dx);
-bool ParseHeight(const char *name, const char *val, int& dy);
+// control classes registered with the dialog builder from the start
+// (see GetControlRegistry() in UIDlgBuilder.cpp), the C++ class is the name with UI appended
+#define KNOWN_CONTROLS(V) \
+    V(List) V(Canvas) V(Button) V(Option) V(Toolbar) V(TabPage) \
+    V(ActiveX) V(DropDown) V(FadedLine) V(TaskPanel) V(Statusbar) \
+    V(TabFolder) V(TextPanel) V(ListHeader) V(ListFooter) V(TileLayout) \
+    V(ToolButton) V(ImagePanel) V(LabelPanel) V(ToolGripper) \
+    V(TitleShadow) V(DialogLayout) V(PaddingPanel) V(WarningPanel) \
+    V(SeparatorLine) V(ControlCanvas) V(MultiLineEdit) V(ToolSeparator) \
+    V(VerticalLayout) V(SingleLineEdit) V(SingleLinePick) \
+    V(NavigatorPanel) V(ListHeaderItem) V(GreyTextHeader) \
+    V(ListTextElement) V(NavigatorButton) V(ListHeaderShadow) \
+    V(HorizontalLayout) V(ListLabelElement) V(SearchTitlePanel) \
+    V(ToolbarTitlePanel) V(ListExpandElement)
 
 #endif // !defined(AFX_UIBASE_H__20050509_3DFB_5C7A_C897_0080AD509054__INCLUDED_)
@@ -79,16 +79,20 @@ void ButtonUI::SetWidth(int cxWidth)
     UpdateLayout();
 }
 
-void ButtonUI::SetAttribute(const char* name, const char* value)
-{
-    int n;
-    if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else if (str::Eq(name, "align"))  {
+void ButtonUI::ApplyAttribute(AttrId id, const char* name, const char* value)
+{
+    switch (id) {
+    case ATTR_WIDTH:
+    case ATTR_DX:
+        SetWidth(atoi(value));
+        break;
+    case ATTR_ALIGN:
         if (str::Find(value, "center") != NULL)  m_uTextStyle |= DT_CENTER;
         if (str::Find(value, "right") != NULL)  m_uTextStyle |= DT_RIGHT;
+        break;
+    default:
+        ControlUI::ApplyAttribute(id, name, value);
     }
-    else ControlUI::SetAttribute(name, value);
 }
 
 void ButtonUI::SetPadding(int cx, int cy)
@@ -189,17 +193,22 @@ void OptionUI::SetWidth(int cxWidth)
     UpdateLayout();
 }
 
-void OptionUI::SetAttribute(const char* name, const char* value)
+void OptionUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else if (str::Eq(name, "selected"))
+    switch (id) {
+    case ATTR_WIDTH:
+    case ATTR_DX:
+        SetWidth(atoi(value));
+        break;
+    case ATTR_SELECTED:
         SetCheck(str::Eq(value, "true"));
-    else if (str::Eq(name, "align"))  {
+        break;
+    case ATTR_ALIGN:
         if (str::Find(value, "right") != NULL)  m_uStyle |= DT_RIGHT;
+        break;
+    default:
+        ControlUI::ApplyAttribute(id, name, value);
     }
-    else ControlUI::SetAttribute(name, value);
 }
 
 SIZE OptionUI::EstimateSize(SIZE /*szAvailable*/)
@@ -277,6 +277,13 @@ bool DropDownUI::Add(ControlUI* ctrl)
     return ContainerUI::Add(ctrl);
 }
 
+// items know their index so they can only be appended
+bool DropDownUI::AddAt(ControlUI* ctrl, int idx)
+{
+    if (idx != GetCount())  return false;
+    return Add(ctrl);
+}
+
 bool DropDownUI::Remove(ControlUI* ctrl)
 {
     ASSERT(!"Not supported");
@@ -45,6 +45,7 @@ public:
 
     // IContainerUI
     virtual bool Add(ControlUI* ctrl);
+    virtual bool AddAt(ControlUI* ctrl, int idx);
     virtual bool Remove(ControlUI* ctrl);
     virtual void RemoveAll();
 
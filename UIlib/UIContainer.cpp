@@ -6,7 +6,8 @@ m_hwndScroll(NULL),
     m_iPadding(0),
     m_iScrollPos(0),
     m_bAutoDestroy(true),
-    m_bAllowScrollbars(false)
+    m_bAllowScrollbars(false),
+    m_deferred(NULL)
 {
     m_cxyFixed.cx = m_cxyFixed.cy = 0;
     ::ZeroMemory(&m_rcInset, sizeof(m_rcInset));
@@ -17,6 +18,32 @@ ContainerUI::~ContainerUI()
     RemoveAll();
 }
 
+// a control is shown if it and all its parents are visible
+static bool IsShown(ControlUI* ctrl)
+{
+    for (; ctrl != NULL; ctrl = ctrl->GetParent())  {
+        if (!ctrl->IsVisible())  return false;
+    }
+    return true;
+}
+
+void ContainerUI::SetDeferredChildren(IDeferredChildren* deferred)
+{
+    delete m_deferred;
+    m_deferred = deferred;
+    CreateDeferredChildren();
+}
+
+void ContainerUI::CreateDeferredChildren()
+{
+    if (m_deferred == NULL || m_mgr == NULL || !IsShown(this))  return;
+    // Create() adds to this container, which must not create them again
+    IDeferredChildren* deferred = m_deferred;
+    m_deferred = NULL;
+    deferred->Create(this);
+    delete deferred;
+}
+
 const char* ContainerUI::GetClass() const
 {
     return "ContainerUI";
@@ -25,6 +52,7 @@ const char* ContainerUI::GetClass() const
 void* ContainerUI::GetInterface(const char* name)
 {
     if (str::Eq(name, "Container"))  return static_cast<IContainerUI*>(this);
+    if (str::Eq(name, "LazyContainer"))  return this;
     return ControlUI::GetInterface(name);
 }
 
@@ -47,6 +75,15 @@ bool ContainerUI::Add(ControlUI* ctrl)
     return m_items.Add(ctrl);
 }
 
+bool ContainerUI::AddAt(ControlUI* ctrl, int idx)
+{
+    if (idx < 0 || idx > m_items.GetSize())  return false;
+    if (m_mgr != NULL)  m_mgr->InitControls(ctrl, this);
+    if (m_mgr != NULL)  m_mgr->UpdateLayout();
+    m_items.InsertAt(idx, ctrl);
+    return true;
+}
+
 bool ContainerUI::Remove(ControlUI* ctrl)
 {
     for (int it = 0; m_bAutoDestroy && it < m_items.GetSize(); it++)  {
@@ -63,6 +100,8 @@ void ContainerUI::RemoveAll()
 {
     for (int it = 0; m_bAutoDestroy && it < m_items.GetSize(); it++)  delete static_cast<ControlUI*>(m_items[it]);
     m_items.Empty();
+    delete m_deferred;
+    m_deferred = NULL;
     m_iScrollPos = 0;
     if (m_mgr != NULL)  m_mgr->UpdateLayout();
 }
@@ -104,11 +143,13 @@ void ContainerUI::SetVisible(bool visible)
     // TODO: doesn't show if visible == true but no need to show the scrollbar
     if (m_hwndScroll != NULL)
         ::ShowScrollBar(m_hwndScroll, SB_CTL, visible);
+    // before the children, so that they can tell that they're being shown
+    ControlUI::SetVisible(visible);
     // Hide children as well
     for (int it = 0; it < m_items.GetSize(); it++)  {
         m_items[it]->SetVisible(visible);
     }
-    ControlUI::SetVisible(visible);
+    if (visible)  CreateDeferredChildren();
 }
 
 void ContainerUI::Event(TEventUI& event)
@@ -257,20 +298,34 @@ SIZE ContainerUI::EstimateSize(SIZE /*szAvailable*/)
     return m_cxyFixed;
 }
 
-void ContainerUI::SetAttribute(const char* name, const char* value)
+void ContainerUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
     int n;
-    if (ParseInt(name, value, "inset", n))
+    switch (id) {
+    case ATTR_INSET:
+        n = atoi(value);
         SetInset(CSize(n, n));
-    else if (ParseInt(name, value, "padding", n))
-        SetPadding(n);
-    else if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else if (ParseHeight(name, value, n))
-        SetHeight(n);
-    else if (str::Eq(name, "scrollbar"))
+        break;
+    case ATTR_PADDING:
+        SetPadding(atoi(value));
+        break;
+    case ATTR_WIDTH:
+    case ATTR_DX:
+        SetWidth(atoi(value));
+        break;
+    case ATTR_HEIGHT:
+    case ATTR_DY:
+        SetHeight(atoi(value));
+        break;
+    case ATTR_SCROLLBAR:
         EnableScrollBar(str::Eq(value, "true"));
-    else ControlUI::SetAttribute(name, value);
+        break;
+    case ATTR_LAYER:
+        SetLayer(str::Eq(value, "true"));
+        break;
+    default:
+        ControlUI::ApplyAttribute(id, name, value);
+    }
 }
 
 void ContainerUI::SetManager(PaintManagerUI* manager, ControlUI* parent)
@@ -279,6 +334,7 @@ void ContainerUI::SetManager(PaintManagerUI* manager, ControlUI* parent)
         m_items[it]->SetManager(manager, this);
     }
     ControlUI::SetManager(manager, parent);
+    CreateDeferredChildren();
 }
 
 ControlUI* ContainerUI::FindControl(FINDCONTROLPROC Proc, void* data, UINT uFlags)
@@ -328,7 +384,7 @@ void ContainerUI::DoPaint(HDC hDC, const RECT& rcPaint)
             continue;
         if (!::IntersectRect(&rcTemp, &m_rcItem, &ctrl->GetPos()))
             continue;
-        ctrl->DoPaint(hDC, rcPaint);
+        m_mgr->PaintControl(ctrl, hDC, rcPaint);
     }
 }
 
@@ -371,6 +427,12 @@ void ContainerUI::ProcessScrollbar(RECT rc, int cyRequired)
     }
 }
 
+void ContainerUI::SetLayer(bool layer)
+{
+    m_layer = layer;
+    if (!layer && m_mgr != NULL)  m_mgr->DropLayer(this);
+}
+
 bool ContainerUI::IsScrollYVisible() const
 {
     if (!m_hwndScroll)
@@ -450,10 +512,10 @@ void CanvasUI::DoPaint(HDC hDC, const RECT& rcPaint)
     m_bgCol = col;
 }
 
-void CanvasUI::SetAttribute(const char* name, const char* value)
+void CanvasUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "watermark"))  SetWatermark(value);
-    else ContainerUI::SetAttribute(name, value);
+    if (ATTR_WATERMARK == id)  SetWatermark(value);
+    else ContainerUI::ApplyAttribute(id, name, value);
 }
 
 ControlCanvasUI::ControlCanvasUI()
@@ -479,6 +541,7 @@ const char* VerticalLayoutUI::GetClass() const
 void VerticalLayoutUI::SetPos(RECT rc)
 {
     m_rcItem = rc;
+    if (m_mgr != NULL)  m_mgr->InvalidateHitTest();
     // Adjust for inset
     rc.left += m_rcInset.left;
     rc.top += m_rcInset.top;
@@ -541,6 +604,7 @@ const char* HorizontalLayoutUI::GetClass() const
 void HorizontalLayoutUI::SetPos(RECT rc)
 {
     m_rcItem = rc;
+    if (m_mgr != NULL)  m_mgr->InvalidateHitTest();
     // Adjust for inset
     rc.left += m_rcInset.left;
     rc.top += m_rcInset.top;
@@ -604,6 +668,7 @@ void TileLayoutUI::SetColumns(int nCols)
 void TileLayoutUI::SetPos(RECT rc)
 {
     m_rcItem = rc;
+    if (m_mgr != NULL)  m_mgr->InvalidateHitTest();
     // Adjust for inset
     rc.left += m_rcInset.left;
     rc.top += m_rcInset.top;
@@ -682,6 +747,24 @@ void DialogLayoutUI::SetStretchMode(ControlUI* ctrl, UINT uMode)
     m_aModes.Add(&mode);
 }
 
+// the stretch modes remember the positions of the items when the dialog
+// is first laid out, which can't be redone for a new item
+bool DialogLayoutUI::AddAt(ControlUI* ctrl, int idx)
+{
+    return false;
+}
+
+bool DialogLayoutUI::Remove(ControlUI* ctrl)
+{
+    for (int i = 0; i < m_aModes.GetSize(); i++)  {
+        if (static_cast<StretchMode*>(m_aModes[i])->ctrl == ctrl)  {
+            m_aModes.Remove(i);
+            break;
+        }
+    }
+    return ContainerUI::Remove(ctrl);
+}
+
 SIZE DialogLayoutUI::EstimateSize(SIZE szAvailable)
 {
     RecalcArea();
@@ -691,6 +774,7 @@ SIZE DialogLayoutUI::EstimateSize(SIZE szAvailable)
 void DialogLayoutUI::SetPos(RECT rc)
 {
     m_rcItem = rc;
+    if (m_mgr != NULL)  m_mgr->InvalidateHitTest();
     RecalcArea();
 
     ProcessScrollbar(rc, RectDy(m_rcDialog));
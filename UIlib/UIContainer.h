@@ -7,10 +7,24 @@ public:
     virtual ControlUI* GetItem(int idx) const = 0;
     virtual int GetCount() const = 0;
     virtual bool Add(ControlUI* ctrl) = 0;
+    // inserts ctrl so that it becomes the item at idx. Returns false if
+    // the container can't insert there because it orders its items itself
+    virtual bool AddAt(ControlUI* ctrl, int idx) = 0;
     virtual bool Remove(ControlUI* ctrl) = 0;
     virtual void RemoveAll() = 0;
 };
 
+class ContainerUI;
+
+// Children of a container that are only created the first time the
+// container is shown, see the lazy attribute in UIDlgBuilder.cpp
+class IDeferredChildren
+{
+public:
+    virtual ~IDeferredChildren() {}
+    virtual void Create(ContainerUI* container) = 0;
+};
+
 class UILIB_API ContainerUI : public ControlUI, public IContainerUI
 {
 public:
@@ -25,6 +39,7 @@ public:
     virtual ControlUI* GetItem(int idx) const;
     virtual int GetCount() const;
     virtual bool Add(ControlUI* ctrl);
+    virtual bool AddAt(ControlUI* ctrl, int idx);
     virtual bool Remove(ControlUI* ctrl);
     virtual void RemoveAll();
 
@@ -44,11 +59,20 @@ public:
     virtual SIZE EstimateSize(SIZE szAvailable);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
 
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
     void SetManager(PaintManagerUI* manager, ControlUI* parent);
     ControlUI* FindControl(FINDCONTROLPROC Proc, void* data, UINT uFlags);
 
+    // takes ownership of deferred. Until the children are created they
+    // can't be found with FindControl()
+    void SetDeferredChildren(IDeferredChildren* deferred);
+
+    // A layer keeps its pixels and paints them again until something
+    // inside it is invalidated, for parts of a dialog that rarely change.
+    // Layers are only kept when painting offscreen.
+    void SetLayer(bool layer);
+
     virtual int GetScrollPos() const;
     virtual int GetScrollPage() const;
     virtual SIZE GetScrollRange() const;
@@ -60,9 +84,11 @@ public:
 protected:
     virtual void ProcessScrollbar(RECT rc, int cyRequired);
     void PaintBackground(HDC hDC, const RECT& rcPaint);
+    void CreateDeferredChildren();
 
 protected:
     Vec<ControlUI*> m_items;
+    IDeferredChildren* m_deferred;
     RECT        m_rcInset;
     int         m_iPadding;
     SIZE        m_cxyFixed;
@@ -84,7 +110,7 @@ public:
     bool SetWatermark(const char* pstrBitmap, int iOrientation = HTBOTTOMRIGHT);
 
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     HBITMAP  m_hBitmap;
@@ -147,6 +173,9 @@ public:
 
     void SetStretchMode(ControlUI* ctrl, UINT uMode);
 
+    virtual bool AddAt(ControlUI* ctrl, int idx);
+    virtual bool Remove(ControlUI* ctrl);
+
     virtual void SetPos(RECT rc);
     virtual SIZE EstimateSize(SIZE szAvailable);
 
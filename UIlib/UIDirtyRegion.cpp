@@ -0,0 +1,75 @@
+#include "UIDirtyRegion.h"
+
+static INT64 Area(const RECT& rc)
+{
+    return (INT64)(rc.right - rc.left) * (rc.bottom - rc.top);
+}
+
+static bool Contains(const RECT& outer, const RECT& inner)
+{
+    return outer.left <= inner.left && outer.top <= inner.top &&
+           outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+// true if the rects overlap or share an edge
+static bool Touch(const RECT& a, const RECT& b)
+{
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+static RECT Union(const RECT& a, const RECT& b)
+{
+    RECT rc = { min(a.left, b.left), min(a.top, b.top), max(a.right, b.right), max(a.bottom, b.bottom) };
+    return rc;
+}
+
+DirtyRegion::DirtyRegion(size_t maxRects) : maxRects(maxRects)
+{
+    ZeroMemory(&bounds, sizeof(bounds));
+}
+
+void DirtyRegion::Reset()
+{
+    rects.Reset();
+    ZeroMemory(&bounds, sizeof(bounds));
+}
+
+void DirtyRegion::Collapse()
+{
+    rects.Reset();
+    rects.Append(bounds);
+}
+
+void DirtyRegion::Add(const RECT& rc)
+{
+    if (rc.right <= rc.left || rc.bottom <= rc.top)
+        return;
+    bounds = IsEmpty() ? rc : Union(bounds, rc);
+
+    RECT merged = rc;
+    for (size_t i = 0; i < rects.Count(); ) {
+        const RECT& other = rects.At(i);
+        if (Contains(other, merged))
+            return;
+        if (Touch(other, merged)) {
+            RECT u = Union(other, merged);
+            if (Area(u) <= Area(other) + Area(merged)) {
+                // merged grew, so it may now touch rects it didn't before
+                merged = u;
+                rects.RemoveAt(i);
+                i = 0;
+                continue;
+            }
+        }
+        i++;
+    }
+    rects.Append(merged);
+
+    // repainting the bounding box costs at most twice as many pixels,
+    // but is a single call
+    INT64 area = 0;
+    for (size_t i = 0; i < rects.Count(); i++)
+        area += Area(rects.At(i));
+    if (rects.Count() > maxRects || (rects.Count() > 1 && 2 * area >= Area(bounds)))
+        Collapse();
+}
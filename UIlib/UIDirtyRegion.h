@@ -0,0 +1,34 @@
+#ifndef UIDirtyRegion_h
+#define UIDirtyRegion_h
+
+#include "BaseUtil.h"
+#include "Vec.h"
+
+// Collects the rects invalidated between two paints so that the window
+// gets a few InvalidateRect() calls per frame instead of one per control.
+// A new rect is merged with those it overlaps or touches when that doesn't
+// add more area than the rects have in common, so a relayout that moves
+// a whole column of controls ends up as a single rect. Past maxRects rects,
+// or once they cover most of their bounding box, the region is reduced
+// to the bounding box.
+class DirtyRegion {
+    Vec<RECT>   rects;
+    RECT        bounds;
+    size_t      maxRects;
+
+    void Collapse();
+public:
+    explicit DirtyRegion(size_t maxRects = 16);
+
+    // empty rects are ignored
+    void Add(const RECT& rc);
+    void Reset();
+
+    bool IsEmpty() const { return rects.Count() == 0; }
+    size_t Count() const { return rects.Count(); }
+    const RECT& At(size_t idx) const { return rects.At(idx); }
+    // the bounding box of all rects added since Reset()
+    const RECT& Bounds() const { return bounds; }
+};
+
+#endif
@@ -2,93 +2,69 @@
 #include "UIDlgBuilder.h"
 #include "UIMarkup.h"
 
-static ControlUI *CreateKnown(const char *cls)
-{
-    switch (str::Len(cls))  {
-    case 4:
-        if (str::Eq(cls, "List")) return new ListUI;
-        break;
-    case 6:
-        if (str::Eq(cls, "Canvas"))         return new CanvasUI;
-        else if (str::Eq(cls, "Button"))    return new ButtonUI;
-        else if (str::Eq(cls, "Option"))    return new OptionUI;
-        break;
-    case 7:
-        if (str::Eq(cls, "Toolbar"))        return new ToolbarUI;
-        else if (str::Eq(cls, "TabPage"))   return new TabPageUI;
-        else if (str::Eq(cls, "ActiveX"))   return new ActiveXUI;
-        break;
-    case 8:
-        if (str::Eq(cls, "DropDown"))       return new DropDownUI;
-        break;
-    case 9:
-        if (str::Eq(cls, "FadedLine"))      return new FadedLineUI;      
-        else if (str::Eq(cls, "TaskPanel")) return new TaskPanelUI;
-        else if (str::Eq(cls, "Statusbar")) return new StatusbarUI;
-        else if (str::Eq(cls, "TabFolder")) return new TabFolderUI;
-        else if (str::Eq(cls, "TextPanel")) return new TextPanelUI;
-        break;
-    case 10:
-        if      (str::Eq(cls, "ListHeader"))   return new ListHeaderUI;
-        else if (str::Eq(cls, "ListFooter"))   return new ListFooterUI;
-        else if (str::Eq(cls, "TileLayout"))   return new TileLayoutUI;
-        else if (str::Eq(cls, "ToolButton"))   return new ToolButtonUI;
-        else if (str::Eq(cls, "ImagePanel"))   return new ImagePanelUI;
-        else if (str::Eq(cls, "LabelPanel"))   return new LabelPanelUI;
-        break;
-    case 11:
-        if      (str::Eq(cls, "ToolGripper"))  return new ToolGripperUI;
-        else if (str::Eq(cls, "TitleShadow"))  return new TitleShadowUI;
-        break;
-    case 12:
-        if      (str::Eq(cls, "DialogLayout")) return new DialogLayoutUI;
-        else if (str::Eq(cls, "PaddingPanel")) return new PaddingPanelUI;
-        else if (str::Eq(cls, "WarningPanel")) return new WarningPanelUI;
-        break;
-    case 13:
-        if      (str::Eq(cls, "SeparatorLine"))      return new SeparatorLineUI;
-        else if (str::Eq(cls, "ControlCanvas")) return new ControlCanvasUI;
-        else if (str::Eq(cls, "MultiLineEdit")) return new MultiLineEditUI;
-        else if (str::Eq(cls, "ToolSeparator")) return new ToolSeparatorUI;
-        break;
-    case 14:
-        if      (str::Eq(cls, "VerticalLayout")) return new VerticalLayoutUI;
-        else if (str::Eq(cls, "SingleLineEdit")) return new SingleLineEditUI;
-        else if (str::Eq(cls, "SingleLinePick")) return new SingleLinePickUI;
-        else if (str::Eq(cls, "NavigatorPanel")) return new NavigatorPanelUI;
-        else if (str::Eq(cls, "ListHeaderItem")) return new ListHeaderItemUI;
-        else if (str::Eq(cls, "GreyTextHeader")) return new GreyTextHeaderUI;
-        break;
-    case 15:
-        if      (str::Eq(cls, "ListTextElement")) return new ListTextElementUI;
-        else if (str::Eq(cls, "NavigatorButton")) return new NavigatorButtonUI;      
-        break;
-    case 16:
-        if      (str::Eq(cls, "ListHeaderShadow")) return new ListHeaderShadowUI; 
-        else if (str::Eq(cls, "HorizontalLayout")) return new HorizontalLayoutUI;
-        else if (str::Eq(cls, "ListLabelElement")) return new ListLabelElementUI;
-        else if (str::Eq(cls, "SearchTitlePanel")) return new SearchTitlePanelUI;
-        break;
-    case 17:
-        if      (str::Eq(cls, "ToolbarTitlePanel")) return new ToolbarTitlePanelUI;
-        else if (str::Eq(cls, "ListExpandElement")) return new ListExpandElementUI;
-        break;
+#define CONTROL_FACTORY(name) static ControlUI *Create##name() { return new name##UI; }
+KNOWN_CONTROLS(CONTROL_FACTORY)
+#undef CONTROL_FACTORY
+
+// prepopulated with KNOWN_CONTROLS, applications add their classes with
+// RegisterControlClass()
+static ControlFactoryRegistry *GetControlRegistry()
+{
+    static ControlFactoryRegistry registry;
+    if (0 == registry.Count()) {
+#define REGISTER_CONTROL(name) registry.Register(#name, Create##name);
+        KNOWN_CONTROLS(REGISTER_CONTROL)
+#undef REGISTER_CONTROL
     }
-    return NULL;
+    return &registry;
+}
+
+void RegisterControlClass(const char *cls, ControlFactory factory)
+{
+    GetControlRegistry()->Register(cls, factory);
 }
 
+// a node of a lazy container's subtree that's being recorded. key is what
+// the user field of the markup nodes of its children points to
+struct RecordedNode {
+    void *          key;
+    ReloadNode *    node;
+};
+
 class UIBuilderParserCallback : MarkupParserCallback {
     ControlUI*                first;
     IDialogBuilderCallback *  cb;
     DialogLayoutUI*           stretched;
+    MarkupXmlStreamParser *   stream;
+    // set once controls are added to a dialog that's attached to a window
+    PaintManagerUI *          updating;
+    // the path from the lazy container being recorded to the last node
+    Vec<RecordedNode>         recording;
+
+    bool RecordNode(MarkupNode *node);
+    void DeferChildren(ControlUI *ctrl, const char *cls);
 
 public:
-    UIBuilderParserCallback() : first(NULL), stretched(NULL) {}
-    ~UIBuilderParserCallback() {}
+    UIBuilderParserCallback() : first(NULL), cb(NULL), stretched(NULL), stream(NULL), updating(NULL) {}
+    ~UIBuilderParserCallback();
 
     ControlUI *ParseXml(const char *xml, IDialogBuilderCallback* cb);
     ControlUI *ParseSimple(const char *s, IDialogBuilderCallback* cb);
+    ControlUI *ParseCompiled(const char *data, size_t len, IDialogBuilderCallback* cb);
+    void SetCallback(IDialogBuilderCallback* cb) { this->cb = cb; }
+    IDialogBuilderCallback *GetCallback() const { return cb; }
+    ControlUI *GetFirst() const { return first; }
+    ControlUI *CreateControl(const char *cls);
+    // defers layout and name indexing of mgr until the builder is deleted
+    void BatchUpdates(PaintManagerUI *mgr);
+    void AddControl(ControlUI *ctrl, ControlUI *parent);
+    void ApplyAttribute(ControlUI *ctrl, ControlUI *parent, AttrId id, const char *name, const char *val);
+    void StartXmlStream(IDialogBuilderCallback* cb);
+    bool FeedXmlStream(const char *data, size_t len);
+    ControlUI *FinishXmlStream();
     virtual void NewNode(MarkupNode *node);
+    // attributes of skipped nodes are never looked at
+    virtual bool WantsLazyAttributes() { return true; }
 };
 
 static UINT GetStretchMode(const char *val)
@@ -105,6 +81,56 @@ static UINT GetStretchMode(const char *val)
     return mode;
 }
 
+ControlUI *UIBuilderParserCallback::CreateControl(const char *cls)
+{
+    ControlUI* ctrl = GetControlRegistry()->Create(cls);
+    if (ctrl == NULL && cb != NULL)
+        ctrl = cb->CreateControl(cls);
+    return ctrl;
+}
+
+UIBuilderParserCallback::~UIBuilderParserCallback()
+{
+    delete stream;
+    if (updating)
+        updating->EndUpdate();
+}
+
+void UIBuilderParserCallback::BatchUpdates(PaintManagerUI *mgr)
+{
+    if (mgr && !updating) {
+        updating = mgr;
+        mgr->BeginUpdate();
+    }
+}
+
+void UIBuilderParserCallback::AddControl(ControlUI *ctrl, ControlUI *parent)
+{
+    if (NULL == first)
+        first = ctrl;
+    if (parent) {
+        BatchUpdates(parent->GetManager());
+        IContainerUI* container = (IContainerUI*)parent->GetInterface("Container");
+        if (container)
+            container->Add(ctrl);
+    }
+}
+
+void UIBuilderParserCallback::ApplyAttribute(ControlUI *ctrl, ControlUI *parent, AttrId id, const char *name, const char *val)
+{
+    if (ATTR_STRETCH == id) {
+        if (stretched == NULL)
+            stretched = (DialogLayoutUI*)parent->GetInterface("DialogLayout");
+        ASSERT(stretched);
+        if (stretched) {
+            UINT mode = GetStretchMode(val);
+            stretched->SetStretchMode(ctrl, mode);
+        }
+    } else {
+        ctrl->ApplyAttribute(id, name, val);
+    }
+}
+
 void UIBuilderParserCallback::NewNode(MarkupNode *node)
 {
     ControlUI* parent = NULL;
@@ -113,46 +139,32 @@ void UIBuilderParserCallback::NewNode(MarkupNode *node)
     // for compat with the old code, skip the Dialog node if it's the first node
     if (str::Eq(cls, "Dialog") && !node->Parent())
         return;
+    if (RecordNode(node))
+        return;
 
-    ControlUI* ctrl = CreateKnown(cls);
-    if (ctrl == NULL && cb != NULL)  {
-        ctrl = cb->CreateControl(cls);
-    }
+    ControlUI* ctrl = CreateControl(cls);
     if (!ctrl)
         return;
-    if (NULL == first)
-        first = ctrl;
 
     assert(NULL == node->user);
     node->user = (void*)ctrl;
 
-    if (node->Parent()) {
+    if (node->Parent())
         parent = (ControlUI*) node->Parent()->user;
-        if (parent) {
-            IContainerUI* container = (IContainerUI*)parent->GetInterface("Container");
-            if (container)
-                container->Add(ctrl);
-        }
-    }
+    AddControl(ctrl, parent);
 
-    if (NULL == node->attributes)
-        return;
-    int n = node->attributes->Count() / 2;
-    for (int i = 0; i < n; i++) {
-        char *name = node->attributes->At(i*2);
-        char *val = node->attributes->At(i*2+1);
-        if (str::Eq(name, "stretch")) {
-            if (stretched == NULL)
-                stretched = (DialogLayoutUI*)parent->GetInterface("DialogLayout");
-            ASSERT(stretched);
-            if (stretched) {
-                UINT mode = GetStretchMode(val);
-                stretched->SetStretchMode(ctrl, mode);
-            }
-        } else {
-            ctrl->SetAttribute(name, val);
-        }
+    bool lazy = false;
+    size_t n = node->AttributesCount();
+    for (size_t i = 0; i < n; i++) {
+        const char *name = node->AttributeName(i);
+        const char *val = node->AttributeValue(i);
+        AttrId id = AttrIdFromName(name);
+        if (ATTR_LAZY == id)
+            lazy = str::Eq(val, "true");
+        ApplyAttribute(ctrl, parent, id, name, val);
     }
+    if (lazy)
+        DeferChildren(ctrl, cls);
 }
 
 ControlUI *UIBuilderParserCallback::ParseXml(const char *xml, IDialogBuilderCallback* cb)
@@ -169,6 +181,91 @@ ControlUI *UIBuilderParserCallback::ParseSimple(const char *s, IDialogBuilderCal
     return first;
 }
 
+ControlUI *UIBuilderParserCallback::ParseCompiled(const char *data, size_t len, IDialogBuilderCallback* cb)
+{
+    this->cb = cb;
+    ParseMarkupCompiled(data, len, this);
+    return first;
+}
+
+void UIBuilderParserCallback::StartXmlStream(IDialogBuilderCallback* cb)
+{
+    this->cb = cb;
+    stream = new MarkupXmlStreamParser(this);
+}
+
+bool UIBuilderParserCallback::FeedXmlStream(const char *data, size_t len)
+{
+    return stream->Feed(data, len);
+}
+
+ControlUI *UIBuilderParserCallback::FinishXmlStream()
+{
+    stream->Finish();
+    return first;
+}
+
+DialogCodeBuilder::DialogCodeBuilder(IDialogBuilderCallback* cb) :
+    cb(cb), curr(NULL), currParent(NULL)
+{
+    builder = new UIBuilderParserCallback();
+    builder->SetCallback(cb);
+}
+
+DialogCodeBuilder::~DialogCodeBuilder()
+{
+    delete builder;
+}
+
+void DialogCodeBuilder::Node(ControlUI *ctrl, int parentIdx)
+{
+    ControlUI *parent = NULL;
+    if (parentIdx >= 0)
+        parent = controls.At(parentIdx);
+    controls.Append(ctrl);
+    curr = ctrl;
+    currParent = parent;
+    if (ctrl)
+        builder->AddControl(ctrl, parent);
+}
+
+void DialogCodeBuilder::CustomNode(const char *cls, int parentIdx)
+{
+    Node(builder->CreateControl(cls), parentIdx);
+}
+
+void DialogCodeBuilder::Attribute(AttrId id, const char *name, const char *value)
+{
+    if (curr)
+        builder->ApplyAttribute(curr, currParent, id, name, value);
+}
+
+ControlUI *DialogCodeBuilder::Finish()
+{
+    return builder->GetFirst();
+}
+
+DialogXmlStream::DialogXmlStream(IDialogBuilderCallback* cb)
+{
+    builder = new UIBuilderParserCallback();
+    builder->StartXmlStream(cb);
+}
+
+DialogXmlStream::~DialogXmlStream()
+{
+    delete builder;
+}
+
+bool DialogXmlStream::Feed(const char *data, size_t len)
+{
+    return builder->FeedXmlStream(data, len);
+}
+
+ControlUI *DialogXmlStream::Finish()
+{
+    return builder->FinishXmlStream();
+}
+
 ControlUI* CreateDialogFromXml(const char* xml, IDialogBuilderCallback* cb)
 {
     UIBuilderParserCallback *p = new UIBuilderParserCallback();
@@ -184,3 +281,557 @@ ControlUI* CreateDialogFromSimple(const char* s, IDialogBuilderCallback* cb)
     delete p;
     return res;
 }
+
+// data is compiled markup, see CompileMarkupXml()
+ControlUI* CreateDialogFromCompiled(const char* data, size_t len, IDialogBuilderCallback* cb)
+{
+    UIBuilderParserCallback *p = new UIBuilderParserCallback();
+    ControlUI* res = p->ParseCompiled(data, len, cb);
+    delete p;
+    return res;
+}
+
+struct DialogTemplate {
+    UINT32      hash;
+    bool        isXml;
+    char *      markup;
+    // NULL if not yet compiled or if markup is malformed
+    char *      image;
+    size_t      imageLen;
+    bool        compiled;
+};
+
+DialogTemplateCache::~DialogTemplateCache()
+{
+    Clear();
+}
+
+void DialogTemplateCache::Clear()
+{
+    for (size_t i = 0; i < templates.Count(); i++) {
+        DialogTemplate *t = templates.At(i);
+        free(t->markup);
+        free(t->image);
+        delete t;
+    }
+    templates.Reset();
+}
+
+// compiling doesn't touch any UI state so it's safe to do on any thread
+static void CompileTemplate(DialogTemplate *t)
+{
+    if (t->isXml)
+        t->image = CompileMarkupXml(t->markup, &t->imageLen);
+    else
+        t->image = CompileMarkupSimple(t->markup, &t->imageLen);
+    t->compiled = true;
+}
+
+// returns the template for the markup, adding an uncompiled one if needed
+DialogTemplate *DialogTemplateCache::Get(const char *markup, bool isXml)
+{
+    UINT32 hash = str::Hash(markup);
+    for (size_t i = 0; i < templates.Count(); i++) {
+        DialogTemplate *t = templates.At(i);
+        // the text is only compared to rule out hash collisions
+        if (t->hash == hash && t->isXml == isXml && str::Eq(t->markup, markup))
+            return t;
+    }
+
+    DialogTemplate *t = new DialogTemplate;
+    t->hash = hash;
+    t->isXml = isXml;
+    t->markup = str::Dup(markup);
+    t->image = NULL;
+    t->imageLen = 0;
+    t->compiled = false;
+    templates.Append(t);
+    return t;
+}
+
+ControlUI *DialogTemplateCache::Create(const char *markup, bool isXml, IDialogBuilderCallback* cb)
+{
+    DialogTemplate *t = Get(markup, isXml);
+    if (!t->compiled)
+        CompileTemplate(t);
+    // let the parser build whatever it can from malformed markup, as usual
+    if (!t->image)
+        return isXml ? CreateDialogFromXml(markup, cb) : CreateDialogFromSimple(markup, cb);
+    return CreateDialogFromCompiled(t->image, t->imageLen, cb);
+}
+
+void DialogTemplateCache::AddXml(const char* xml)
+{
+    Get(xml, true);
+}
+
+void DialogTemplateCache::AddSimple(const char* s)
+{
+    Get(s, false);
+}
+
+struct PrecompileCtx {
+    Vec<DialogTemplate*> *  templates;
+    LONG                    next;
+};
+
+static DWORD WINAPI PrecompileThread(LPVOID data)
+{
+    PrecompileCtx *ctx = (PrecompileCtx *)data;
+    for (;;) {
+        LONG i = InterlockedIncrement(&ctx->next) - 1;
+        if (i >= (LONG)ctx->templates->Count())
+            break;
+        DialogTemplate *t = ctx->templates->At(i);
+        if (!t->compiled)
+            CompileTemplate(t);
+    }
+    return 0;
+}
+
+// Compiles all templates added with AddXml()/AddSimple() on workersCount
+// threads (including the calling thread) and returns when they're done.
+// Creating dialogs from them afterwards only creates the controls.
+void DialogTemplateCache::Precompile(int workersCount)
+{
+    PrecompileCtx ctx = { &templates, 0 };
+    HANDLE threads[MAXIMUM_WAIT_OBJECTS];
+    int threadsCount = 0;
+    for (int i = 1; i < workersCount && threadsCount < MAXIMUM_WAIT_OBJECTS; i++) {
+        HANDLE h = CreateThread(NULL, 0, PrecompileThread, &ctx, 0, NULL);
+        if (!h)
+            break;
+        threads[threadsCount++] = h;
+    }
+    // the calling thread works as well, so all templates get compiled
+    // even if no thread could be created
+    PrecompileThread(&ctx);
+    if (threadsCount > 0)
+        WaitForMultipleObjects(threadsCount, threads, TRUE, INFINITE);
+    for (int i = 0; i < threadsCount; i++)
+        CloseHandle(threads[i]);
+}
+
+ControlUI *DialogTemplateCache::CreateFromXml(const char* xml, IDialogBuilderCallback* cb)
+{
+    return Create(xml, true, cb);
+}
+
+ControlUI *DialogTemplateCache::CreateFromSimple(const char* s, IDialogBuilderCallback* cb)
+{
+    return Create(s, false, cb);
+}
+
+// the file is mapped into memory instead of read. Controls copy
+// the strings they need so it's unmapped as soon as we're done
+ControlUI* CreateDialogFromCompiledFile(const char* filePath, IDialogBuilderCallback* cb)
+{
+    size_t len;
+    const char *data = file::MapReadOnly(filePath, &len);
+    if (!data)
+        return NULL;
+    ControlUI* res = CreateDialogFromCompiled(data, len, cb);
+    file::Unmap(data);
+    return res;
+}
+
+// a markup node and the control created from it
+struct ReloadNode {
+    char *              cls;
+    Vec<char*>          attrNames;
+    Vec<char*>          attrValues;
+    Vec<ReloadNode*>    children;
+    // NULL if no control was created for the node
+    ControlUI *         ctrl;
+
+    ReloadNode(const char *cls) : cls(str::Dup(cls)), ctrl(NULL) {}
+    ~ReloadNode();
+
+    const char *GetAttribute(const char *name) const;
+};
+
+ReloadNode::~ReloadNode()
+{
+    free(cls);
+    for (size_t i = 0; i < attrNames.Count(); i++) {
+        free(attrNames.At(i));
+        free(attrValues.At(i));
+    }
+    DeleteVecMembers(children);
+}
+
+const char *ReloadNode::GetAttribute(const char *name) const
+{
+    for (size_t i = 0; i < attrNames.Count(); i++) {
+        if (str::Eq(attrNames.At(i), name))
+            return attrValues.At(i);
+    }
+    return NULL;
+}
+
+// The children of a container with lazy="true" (e.g. a TabPage other than
+// the first one) aren't created when the dialog is built. Their markup is
+// recorded and the controls are created the first time the container is
+// shown, so opening the dialog doesn't pay for pages that are never seen
+class DeferredSubtree : public IDeferredChildren {
+    // the container's node, only its children are used
+    ReloadNode *                root;
+    // not owned, see IDialogBuilderCallback
+    IDialogBuilderCallback *    cb;
+public:
+    DeferredSubtree(ReloadNode *root, IDialogBuilderCallback *cb) : root(root), cb(cb) {}
+    virtual ~DeferredSubtree() { delete root; }
+    virtual void Create(ContainerUI* container);
+};
+
+// the control is built before it's added to parent, so that it's
+// initialized with all its attributes
+static ControlUI *BuildDeferred(ReloadNode *n, ControlUI *parent, UIBuilderParserCallback *builder)
+{
+    ControlUI *ctrl = builder->CreateControl(n->cls);
+    if (!ctrl)
+        return NULL;
+    bool lazy = false;
+    for (size_t i = 0; i < n->attrNames.Count(); i++) {
+        const char *name = n->attrNames.At(i);
+        AttrId id = AttrIdFromName(name);
+        if (ATTR_LAZY == id)
+            lazy = str::Eq(n->attrValues.At(i), "true");
+        builder->ApplyAttribute(ctrl, parent, id, name, n->attrValues.At(i));
+    }
+
+    ContainerUI *container = lazy ? (ContainerUI*)ctrl->GetInterface("LazyContainer") : NULL;
+    if (container && n->children.Count() > 0) {
+        ReloadNode *root = new ReloadNode(n->cls);
+        for (size_t i = 0; i < n->children.Count(); i++)
+            root->children.Append(n->children.At(i));
+        n->children.Reset();
+        container->SetDeferredChildren(new DeferredSubtree(root, builder->GetCallback()));
+        return ctrl;
+    }
+    for (size_t i = 0; i < n->children.Count(); i++) {
+        ControlUI *child = BuildDeferred(n->children.At(i), ctrl, builder);
+        if (child)
+            builder->AddControl(child, ctrl);
+    }
+    return ctrl;
+}
+
+void DeferredSubtree::Create(ContainerUI* container)
+{
+    UIBuilderParserCallback builder;
+    builder.SetCallback(cb);
+    for (size_t i = 0; i < root->children.Count(); i++) {
+        ControlUI *ctrl = BuildDeferred(root->children.At(i), container, &builder);
+        if (ctrl)
+            builder.AddControl(ctrl, container);
+    }
+}
+
+void UIBuilderParserCallback::DeferChildren(ControlUI *ctrl, const char *cls)
+{
+    // the children of a container that's already shown would be created
+    // right away, while the recording is still incomplete
+    if (ctrl->GetManager())
+        return;
+    ContainerUI *container = (ContainerUI*)ctrl->GetInterface("LazyContainer");
+    if (!container)
+        return;
+    ReloadNode *root = new ReloadNode(cls);
+    container->SetDeferredChildren(new DeferredSubtree(root, cb));
+    RecordedNode rec = { ctrl, root };
+    recording.Append(rec);
+}
+
+// returns true if node is in the subtree of a lazy container, in which case
+// it's added to the recording instead of being built. Nodes are reported
+// in document order, so a node is recorded if its parent is on the path
+bool UIBuilderParserCallback::RecordNode(MarkupNode *node)
+{
+    if (recording.Count() == 0)
+        return false;
+    void *parentKey = node->Parent() ? node->Parent()->user : NULL;
+    while (recording.Count() > 0 && recording.Last().key != parentKey)
+        recording.Pop();
+    if (recording.Count() == 0)
+        return false;
+
+    ReloadNode *n = new ReloadNode(node->name);
+    size_t count = node->AttributesCount();
+    for (size_t i = 0; i < count; i++) {
+        n->attrNames.Append(str::Dup(node->AttributeName(i)));
+        n->attrValues.Append(str::Dup(node->AttributeValue(i)));
+    }
+    recording.Last().node->children.Append(n);
+    node->user = (void*)n;
+    RecordedNode rec = { n, n };
+    recording.Append(rec);
+    return true;
+}
+
+class ReloadTreeParserCallback : public MarkupParserCallback {
+public:
+    // nodes without a parent
+    Vec<ReloadNode*> topLevel;
+
+    virtual void NewNode(MarkupNode *node);
+};
+
+void ReloadTreeParserCallback::NewNode(MarkupNode *node)
+{
+    ReloadNode *n = new ReloadNode(node->name);
+    size_t count = node->AttributesCount();
+    for (size_t i = 0; i < count; i++) {
+        n->attrNames.Append(str::Dup(node->AttributeName(i)));
+        n->attrValues.Append(str::Dup(node->AttributeValue(i)));
+    }
+    node->user = (void*)n;
+    if (node->Parent())
+        ((ReloadNode*)node->Parent()->user)->children.Append(n);
+    else
+        topLevel.Append(n);
+}
+
+// returns NULL if the markup is malformed
+static ReloadNode *ParseReloadTree(const char *markup, bool isXml)
+{
+    ReloadTreeParserCallback cb;
+    bool ok;
+    if (isXml)
+        ok = ParseMarkupXml(markup, &cb);
+    else
+        ok = ParseMarkupSimple(markup, &cb);
+    // like the builder, only the first top-level node makes a dialog
+    ReloadNode *tree = NULL;
+    for (size_t i = 0; i < cb.topLevel.Count(); i++) {
+        if (ok && 0 == i)
+            tree = cb.topLevel.At(i);
+        else
+            delete cb.topLevel.At(i);
+    }
+    return tree;
+}
+
+// the node the root control is created from. The Dialog node is skipped
+// as in UIBuilderParserCallback::NewNode()
+static ReloadNode *DialogRoot(ReloadNode *tree)
+{
+    if (tree && str::Eq(tree->cls, "Dialog"))
+        return tree->children.Count() > 0 ? tree->children.At(0) : NULL;
+    return tree;
+}
+
+static ControlUI *BuildControls(ReloadNode *n, ControlUI *parent, UIBuilderParserCallback *builder)
+{
+    n->ctrl = builder->CreateControl(n->cls);
+    if (!n->ctrl)
+        return NULL;
+    for (size_t i = 0; i < n->attrNames.Count(); i++) {
+        const char *name = n->attrNames.At(i);
+        builder->ApplyAttribute(n->ctrl, parent, AttrIdFromName(name), name, n->attrValues.At(i));
+    }
+    for (size_t i = 0; i < n->children.Count(); i++) {
+        ControlUI *ctrl = BuildControls(n->children.At(i), n->ctrl, builder);
+        if (ctrl)
+            builder->AddControl(ctrl, n->ctrl);
+    }
+    return n->ctrl;
+}
+
+// returns the index of the node in olds (starting at from) that n should
+// update or -1 if n is a new node. Named nodes are looked up by name,
+// others are only matched to the node at their position
+static int FindMatch(Vec<ReloadNode*>& olds, size_t from, ReloadNode *n)
+{
+    const char *name = n->GetAttribute("name");
+    if (!name) {
+        if (from < olds.Count() && str::Eq(olds.At(from)->cls, n->cls) && !olds.At(from)->GetAttribute("name"))
+            return (int)from;
+        return -1;
+    }
+    for (size_t i = from; i < olds.Count(); i++) {
+        ReloadNode *o = olds.At(i);
+        if (str::Eq(o->cls, n->cls) && str::Eq(o->GetAttribute("name"), name))
+            return (int)i;
+    }
+    return -1;
+}
+
+static bool PatchAttributes(ReloadNode *o, ReloadNode *n, ControlUI *parent, UIBuilderParserCallback *builder)
+{
+    size_t oldCount = o->attrNames.Count();
+    size_t newCount = n->attrNames.Count();
+    // attributes are applied in order and one can depend on the ones
+    // before it, so everything after the first change is applied again
+    size_t first = 0;
+    while (first < oldCount && first < newCount &&
+           str::Eq(o->attrNames.At(first), n->attrNames.At(first)) &&
+           str::Eq(o->attrValues.At(first), n->attrValues.At(first))) {
+        first++;
+    }
+    if (first == oldCount && first == newCount)
+        return true;
+
+    // DialogLayoutUI only looks at the positions of its items once
+    if (parent && parent->GetInterface("DialogLayout"))
+        return false;
+    // there's no way to reset an attribute to its default
+    for (size_t i = first; i < oldCount; i++) {
+        if (!n->GetAttribute(o->attrNames.At(i)))
+            return false;
+    }
+    for (size_t i = first; i < newCount; i++) {
+        const char *name = n->attrNames.At(i);
+        builder->ApplyAttribute(n->ctrl, parent, AttrIdFromName(name), name, n->attrValues.At(i));
+    }
+    return true;
+}
+
+// Updates the control of o to match n and moves it to n. Returns false
+// if the control has to be recreated instead, it might have been
+// partially updated by then
+static bool PatchControls(ReloadNode *o, ReloadNode *n, ControlUI *parent, UIBuilderParserCallback *builder)
+{
+    if (!o->ctrl || !str::Eq(o->cls, n->cls))
+        return false;
+    n->ctrl = o->ctrl;
+    if (!PatchAttributes(o, n, parent, builder))
+        return false;
+    if (0 == o->children.Count() && 0 == n->children.Count())
+        return true;
+
+    IContainerUI* container = (IContainerUI*)n->ctrl->GetInterface("Container");
+    if (!container)
+        return false;
+
+    // nodes keep their order so the old nodes skipped over are gone
+    Vec<ReloadNode*> matches;
+    Vec<ReloadNode*> removed;
+    size_t next = 0;
+    for (size_t i = 0; i < n->children.Count(); i++) {
+        ReloadNode *match = NULL;
+        int idx = FindMatch(o->children, next, n->children.At(i));
+        if (idx >= 0) {
+            for (; next < (size_t)idx; next++)
+                removed.Append(o->children.At(next));
+            match = o->children.At(next++);
+        }
+        matches.Append(match);
+    }
+    for (; next < o->children.Count(); next++)
+        removed.Append(o->children.At(next));
+
+    for (size_t i = 0; i < removed.Count(); i++) {
+        ControlUI *ctrl = removed.At(i)->ctrl;
+        if (ctrl && !container->Remove(ctrl))
+            return false;
+    }
+
+    // the controls of the nodes before i are now the first pos items
+    int pos = 0;
+    for (size_t i = 0; i < n->children.Count(); i++) {
+        ReloadNode *child = n->children.At(i);
+        ReloadNode *match = matches.At(i);
+        if (match && PatchControls(match, child, n->ctrl, builder)) {
+            pos++;
+            continue;
+        }
+        if (match && match->ctrl && !container->Remove(match->ctrl))
+            return false;
+        ControlUI *ctrl = BuildControls(child, n->ctrl, builder);
+        if (!ctrl)
+            continue;
+        if (!container->AddAt(ctrl, pos)) {
+            delete ctrl;
+            return false;
+        }
+        pos++;
+    }
+    return true;
+}
+
+DialogReloader::DialogReloader(IDialogBuilderCallback* cb) :
+    cb(cb), isXml(true), tree(NULL), root(NULL), lastMarkup(NULL)
+{
+}
+
+// the controls belong to whoever the dialog was given to
+DialogReloader::~DialogReloader()
+{
+    delete tree;
+    free((void*)lastMarkup);
+}
+
+ControlUI *DialogReloader::Create(const char *markup, bool isXml)
+{
+    delete tree;
+    this->isXml = isXml;
+    str::Replace(lastMarkup, markup);
+    tree = ParseReloadTree(markup, isXml);
+    root = NULL;
+    ReloadNode *n = DialogRoot(tree);
+    if (n) {
+        UIBuilderParserCallback builder;
+        builder.SetCallback(cb);
+        root = BuildControls(n, NULL, &builder);
+    }
+    return root;
+}
+
+ControlUI *DialogReloader::CreateFromXml(const char* xml)
+{
+    return Create(xml, true);
+}
+
+ControlUI *DialogReloader::CreateFromSimple(const char* s)
+{
+    return Create(s, false);
+}
+
+ControlUI *DialogReloader::Reload(const char* markup)
+{
+    ReloadNode *newTree = ParseReloadTree(markup, isXml);
+    if (!newTree)
+        return NULL;
+
+    UIBuilderParserCallback builder;
+    builder.SetCallback(cb);
+    ReloadNode *oldRoot = DialogRoot(tree);
+    ReloadNode *newRoot = DialogRoot(newTree);
+    PaintManagerUI *mgr = root ? root->GetManager() : NULL;
+    // the patched dialog is laid out once, when builder goes out of scope
+    builder.BatchUpdates(mgr);
+    ControlUI *res = root;
+    if (!oldRoot || !newRoot || !PatchControls(oldRoot, newRoot, NULL, &builder)) {
+        res = newRoot ? BuildControls(newRoot, NULL, &builder) : NULL;
+        // the dialog stays as it is. A failed patch can only have touched
+        // it if the root kept its class, which then can be created again
+        if (!res) {
+            delete newTree;
+            return NULL;
+        }
+        // AttachDialog() deletes the old root once it's safe to do so
+        if (mgr)
+            mgr->AttachDialog(res);
+        else
+            delete root;
+    } else if (mgr) {
+        mgr->UpdateLayout();
+    }
+
+    delete tree;
+    tree = newTree;
+    root = res;
+    str::Replace(lastMarkup, markup);
+    return res;
+}
+
+ControlUI *DialogReloader::ReloadFile(const char* filePath)
+{
+    ScopedMem<char> s(file::ReadAll(filePath, NULL));
+    if (!s)
+        return NULL;
+    if (lastMarkup && str::Eq(s, lastMarkup))
+        return root;
+    return Reload(s);
+}
@@ -1,13 +1,128 @@
 #if !defined(AFX_BLUEBUILDER_H__20050505_A1C5_1D19_C2BA_0080AD509054__INCLUDED_)
 #define AFX_BLUEBUILDER_H__20050505_A1C5_1D19_C2BA_0080AD509054__INCLUDED_
 
+// Creates the controls of classes that aren't registered. The children of
+// a container with lazy="true" are created the first time the container
+// is shown, with the callback the dialog was created with. The callback
+// must then outlive such containers, e.g. not be a local variable of the
+// function that creates the dialog.
 class IDialogBuilderCallback
 {
 public:
     virtual ControlUI* CreateControl(const char* pstrClass) = 0;
 };
 
+// Makes cls usable in markup of all dialogs, without IDialogBuilderCallback.
+// Registering a class that's in KNOWN_CONTROLS replaces the built-in one
+void RegisterControlClass(const char* cls, ControlFactory factory);
+
 ControlUI* CreateDialogFromXml(const char* xml, IDialogBuilderCallback* cb = NULL);
 ControlUI* CreateDialogFromSimple(const char* s, IDialogBuilderCallback* cb = NULL);
+// compiled markup is produced at build time by MarkupCompiler
+ControlUI* CreateDialogFromCompiled(const char* data, size_t len, IDialogBuilderCallback* cb = NULL);
+ControlUI* CreateDialogFromCompiledFile(const char* filePath, IDialogBuilderCallback* cb = NULL);
+
+struct DialogTemplate;
+
+// Keeps parsed markup (as compiled markup, see CompileMarkupXml()) keyed
+// by a hash of the markup text. Creating a dialog from markup that's
+// already cached builds the controls without running the parser.
+// Markup added with AddXml()/AddSimple() can be parsed up front on
+// several threads with Precompile()
+class DialogTemplateCache
+{
+    Vec<DialogTemplate*> templates;
+
+    DialogTemplate *Get(const char *markup, bool isXml);
+    ControlUI *Create(const char *markup, bool isXml, IDialogBuilderCallback* cb);
+public:
+    ~DialogTemplateCache();
+
+    void AddXml(const char* xml);
+    void AddSimple(const char* s);
+    void Precompile(int workersCount);
+
+    ControlUI *CreateFromXml(const char* xml, IDialogBuilderCallback* cb = NULL);
+    ControlUI *CreateFromSimple(const char* s, IDialogBuilderCallback* cb = NULL);
+    void Clear();
+};
+
+class UIBuilderParserCallback;
+
+// Used by the code MarkupCompiler -cpp generates from markup. It creates
+// the same tree as CreateDialogFromXml() on the same markup, but the
+// controls are constructed directly and attribute ids are constants.
+// Nodes are numbered in the order they are added, NULL is a skipped node
+class DialogCodeBuilder
+{
+    UIBuilderParserCallback *   builder;
+    IDialogBuilderCallback *    cb;
+    Vec<ControlUI*>             controls;
+    ControlUI *                 curr;
+    ControlUI *                 currParent;
+public:
+    DialogCodeBuilder(IDialogBuilderCallback* cb = NULL);
+    ~DialogCodeBuilder();
+
+    void Node(ControlUI *ctrl, int parentIdx);
+    // for classes not in KNOWN_CONTROLS: registered with RegisterControlClass()
+    // or created by IDialogBuilderCallback
+    void CustomNode(const char *cls, int parentIdx);
+    // applies to the last added node
+    void Attribute(AttrId id, const char *name, const char *value);
+    ControlUI *Finish();
+};
+
+// Like CreateDialogFromXml() but for xml that arrives in chunks. Controls
+// are created as soon as their tag has been fed, so construction can
+// overlap with reading the rest of the file
+class DialogXmlStream
+{
+    UIBuilderParserCallback *builder;
+public:
+    DialogXmlStream(IDialogBuilderCallback* cb = NULL);
+    ~DialogXmlStream();
+
+    // returns false if the xml is malformed
+    bool Feed(const char *data, size_t len);
+    ControlUI *Finish();
+};
+
+struct ReloadNode;
+
+// Creates a dialog from markup and later updates it in place when the
+// markup changes (e.g. when the file it was loaded from is edited).
+// Controls are matched to the new markup by name or, for controls without
+// a name, by position among their siblings. Only controls that were added,
+// removed or whose attributes changed are touched, the others keep their
+// focus, scroll position and selection. A control is recreated if an
+// attribute was removed or its container can't insert at its position.
+// If the dialog has been attached to a PaintManagerUI, a recreated root is
+// attached in place of the old one, otherwise the old root is deleted
+class DialogReloader
+{
+    IDialogBuilderCallback *    cb;
+    bool                        isXml;
+    ReloadNode *                tree;
+    ControlUI *                 root;
+    // the markup the controls were last built or patched from
+    const char *                lastMarkup;
+
+    ControlUI *Create(const char *markup, bool isXml);
+public:
+    DialogReloader(IDialogBuilderCallback* cb = NULL);
+    ~DialogReloader();
+
+    ControlUI *CreateFromXml(const char* xml);
+    ControlUI *CreateFromSimple(const char* s);
+    // markup is in the same format as the one the dialog was created
+    // from. Returns the root, which might have been recreated, or NULL
+    // if no dialog can be built from the markup in which case nothing
+    // is changed
+    ControlUI *Reload(const char* markup);
+    // does nothing if the file's content is what was loaded last
+    ControlUI *ReloadFile(const char* filePath);
+    ControlUI *GetRoot() const { return root; }
+};
 
 #endif // !defined(AFX_BLUEBUILDER_H__20050505_A1C5_1D19_C2BA_0080AD509054__INCLUDED_)
@@ -138,7 +138,7 @@ void SingleLineEditUI::Event(TEventUI& event)
 
 void SingleLineEditUI::SetText(const char* txt)
 {
-    str::Replace(m_txt, txt);
+    GetStringPool()->Replace(m_txt, txt);
     if (m_mgr != NULL)  m_mgr->SendNotify(this, "changed");
     Invalidate();
 }
@@ -272,7 +272,7 @@ UINT MultiLineEditUI::GetControlFlags() const
 
 void MultiLineEditUI::SetText(const char* txt)
 {
-    str::Replace(m_txt, txt);
+    GetStringPool()->Replace(m_txt, txt);
     if (m_win != NULL)  SetWindowTextUtf8(*m_win, txt);
     if (m_mgr != NULL)  m_mgr->SendNotify(this, "changed");
     Invalidate();
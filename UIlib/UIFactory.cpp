@@ -0,0 +1,68 @@
+#include "UIFactory.h"
+#include "StrUtil.h"
+
+ControlFactoryRegistry::ControlFactoryRegistry() : entries(NULL), capacity(0), count(0)
+{
+}
+
+ControlFactoryRegistry::~ControlFactoryRegistry()
+{
+    for (size_t i = 0; i < capacity; i++) {
+        free(entries[i].cls);
+    }
+    free(entries);
+}
+
+// returns the slot of cls or the empty slot where it would be added
+ControlFactoryRegistry::Entry *ControlFactoryRegistry::FindSlot(const char *cls, UINT32 hash) const
+{
+    size_t mask = capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        Entry *e = &entries[i];
+        if (!e->cls)
+            return e;
+        // the name is only compared to rule out hash collisions
+        if (e->hash == hash && str::Eq(e->cls, cls))
+            return e;
+    }
+}
+
+void ControlFactoryRegistry::Grow()
+{
+    Entry *old = entries;
+    size_t oldCapacity = capacity;
+    capacity = capacity ? capacity * 2 : 64;
+    entries = SAZA(Entry, capacity);
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].cls)
+            *FindSlot(old[i].cls, old[i].hash) = old[i];
+    }
+    free(old);
+}
+
+void ControlFactoryRegistry::Register(const char *cls, ControlFactory factory)
+{
+    if ((count + 1) * 2 > capacity)
+        Grow();
+    UINT32 hash = str::Hash(cls);
+    Entry *e = FindSlot(cls, hash);
+    if (!e->cls) {
+        e->hash = hash;
+        e->cls = str::Dup(cls);
+        count++;
+    }
+    e->factory = factory;
+}
+
+ControlFactory ControlFactoryRegistry::Find(const char *cls) const
+{
+    if (0 == count)
+        return NULL;
+    return FindSlot(cls, str::Hash(cls))->factory;
+}
+
+ControlUI *ControlFactoryRegistry::Create(const char *cls) const
+{
+    ControlFactory factory = Find(cls);
+    return factory ? factory() : NULL;
+}
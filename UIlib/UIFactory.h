@@ -0,0 +1,41 @@
+#ifndef UIFactory_h
+#define UIFactory_h
+
+#include "BaseUtil.h"
+
+class ControlUI;
+
+typedef ControlUI *(*ControlFactory)();
+
+// Maps the class names used in markup to the functions that create the
+// controls. Lookup hashes the name once and then probes an open addressing
+// table that's kept at most half full, so its cost doesn't depend on the
+// number of registered classes
+class ControlFactoryRegistry {
+    struct Entry {
+        UINT32          hash;
+        // NULL for an empty slot
+        char *          cls;
+        ControlFactory  factory;
+    };
+
+    Entry *     entries;
+    // always a power of 2
+    size_t      capacity;
+    size_t      count;
+
+    Entry *FindSlot(const char *cls, UINT32 hash) const;
+    void Grow();
+public:
+    ControlFactoryRegistry();
+    ~ControlFactoryRegistry();
+
+    // replaces the factory of a class that's already registered
+    void Register(const char *cls, ControlFactory factory);
+    // returns NULL for classes that aren't registered
+    ControlFactory Find(const char *cls) const;
+    ControlUI *Create(const char *cls) const;
+    size_t Count() const { return count; }
+};
+
+#endif
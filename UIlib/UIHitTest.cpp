@@ -0,0 +1,124 @@
+#include "UIHitTest.h"
+
+// a dialog with a few huge rects and many small ones would otherwise
+// get a cell per pixel
+#define MAX_GRID_SIZE   256
+
+static bool ContainsPoint(const RECT& rc, POINT pt)
+{
+    return pt.x >= rc.left && pt.x < rc.right && pt.y >= rc.top && pt.y < rc.bottom;
+}
+
+HitTestGrid::HitTestGrid() : cols(0), rows(0), cellShiftX(0), cellShiftY(0), cellStart(NULL), cellItems(NULL)
+{
+    ZeroMemory(&bounds, sizeof(bounds));
+}
+
+HitTestGrid::~HitTestGrid()
+{
+    FreeCells();
+}
+
+void HitTestGrid::FreeCells()
+{
+    free(cellStart);
+    free(cellItems);
+    cellStart = NULL;
+    cellItems = NULL;
+    cols = rows = 0;
+}
+
+void HitTestGrid::Reset()
+{
+    FreeCells();
+    items.Reset();
+    ZeroMemory(&bounds, sizeof(bounds));
+}
+
+void HitTestGrid::Add(ControlUI *ctrl, const RECT& rc)
+{
+    if (rc.right <= rc.left || rc.bottom <= rc.top)
+        return;
+    if (items.Count() == 0) {
+        bounds = rc;
+    } else {
+        bounds.left = min(bounds.left, rc.left);
+        bounds.top = min(bounds.top, rc.top);
+        bounds.right = max(bounds.right, rc.right);
+        bounds.bottom = max(bounds.bottom, rc.bottom);
+    }
+    Item item = { rc, ctrl };
+    items.Append(item);
+}
+
+bool HitTestGrid::Build()
+{
+    FreeCells();
+    size_t count = items.Count();
+    if (0 == count)
+        return true;
+
+    int size = 1;
+    while (size < MAX_GRID_SIZE && (size_t)size * size < count)
+        size++;
+    int dx = bounds.right - bounds.left, dy = bounds.bottom - bounds.top;
+    // cells are a power of 2 wide and high so that finding a point's cell
+    // is a shift instead of a division
+    for (cellShiftX = 0; ((INT64)size << cellShiftX) < dx; cellShiftX++);
+    for (cellShiftY = 0; ((INT64)size << cellShiftY) < dy; cellShiftY++);
+    cols = ((dx - 1) >> cellShiftX) + 1;
+    rows = ((dy - 1) >> cellShiftY) + 1;
+
+    // count the items per cell, turn the counts into start offsets and
+    // then fill the cells, which keeps each cell's items in order
+    size_t cellsCount = (size_t)cols * rows;
+    cellStart = SAZA(UINT32, cellsCount + 1);
+    if (!cellStart) {
+        FreeCells();
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const RECT& rc = items.At(i).rc;
+        int c0 = (rc.left - bounds.left) >> cellShiftX, c1 = (rc.right - 1 - bounds.left) >> cellShiftX;
+        int r0 = (rc.top - bounds.top) >> cellShiftY, r1 = (rc.bottom - 1 - bounds.top) >> cellShiftY;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++)
+                cellStart[r * cols + c + 1]++;
+        }
+    }
+    for (size_t i = 0; i < cellsCount; i++)
+        cellStart[i + 1] += cellStart[i];
+    cellItems = SAZA(UINT32, cellStart[cellsCount] + 1);
+    UINT32 *next = SAZA(UINT32, cellsCount);
+    if (!cellItems || !next) {
+        free(next);
+        FreeCells();
+        return false;
+    }
+    memcpy(next, cellStart, cellsCount * sizeof(UINT32));
+    for (size_t i = 0; i < count; i++) {
+        const RECT& rc = items.At(i).rc;
+        int c0 = (rc.left - bounds.left) >> cellShiftX, c1 = (rc.right - 1 - bounds.left) >> cellShiftX;
+        int r0 = (rc.top - bounds.top) >> cellShiftY, r1 = (rc.bottom - 1 - bounds.top) >> cellShiftY;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++)
+                cellItems[next[r * cols + c]++] = (UINT32)i;
+        }
+    }
+    free(next);
+    return true;
+}
+
+ControlUI *HitTestGrid::Find(POINT pt) const
+{
+    if (!cellStart || !ContainsPoint(bounds, pt))
+        return NULL;
+    int col = (pt.x - bounds.left) >> cellShiftX, row = (pt.y - bounds.top) >> cellShiftY;
+    size_t cell = (size_t)row * cols + col;
+    for (UINT32 i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+        const Item& item = items.At(cellItems[i]);
+        if (ContainsPoint(item.rc, pt))
+            return item.ctrl;
+    }
+    return NULL;
+}
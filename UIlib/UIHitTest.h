@@ -0,0 +1,46 @@
+#ifndef UIHitTest_h
+#define UIHitTest_h
+
+#include "BaseUtil.h"
+#include "Vec.h"
+
+class ControlUI;
+
+// Answers point queries over the rects of a dialog's controls without
+// walking the control tree. The rects are added in the order in which
+// ControlUI::FindControl() visits the controls, each one already clipped
+// by its ancestors, and Find() returns the first one that contains the
+// point, which is the control a UIFIND_HITTEST walk would return.
+// The rects are bucketed into a uniform grid of about one cell per rect,
+// so a query only tests the few rects that overlap the point's cell
+class HitTestGrid {
+    struct Item {
+        RECT        rc;
+        ControlUI * ctrl;
+    };
+
+    Vec<Item>   items;
+    RECT        bounds;
+    int         cols, rows;
+    int         cellShiftX, cellShiftY;
+    // the items overlapping cell i, in the order they were added, are
+    // cellItems[cellStart[i]] .. cellItems[cellStart[i + 1] - 1]
+    UINT32 *    cellStart;
+    UINT32 *    cellItems;
+
+    void FreeCells();
+public:
+    HitTestGrid();
+    ~HitTestGrid();
+
+    void Reset();
+    // empty rects are ignored
+    void Add(ControlUI *ctrl, const RECT& rc);
+    // must be called after the last Add() and before Find()
+    bool Build();
+    // returns NULL if no rect contains pt
+    ControlUI *Find(POINT pt) const;
+    size_t Count() const { return items.Count(); }
+};
+
+#endif
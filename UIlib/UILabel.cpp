@@ -32,15 +32,20 @@ void LabelPanelUI::SetTextStyle(UINT uStyle)
     Invalidate();
 }
 
-void LabelPanelUI::SetAttribute(const char* name, const char* value)
+void LabelPanelUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (str::Eq(name, "align"))  {
+    switch (id) {
+    case ATTR_ALIGN:
         if (str::Find(value, "center") != NULL)  m_uTextStyle |= DT_CENTER;
         if (str::Find(value, "right") != NULL)   m_uTextStyle |= DT_RIGHT;
-    } else if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else ControlUI::SetAttribute(name, value);
+        break;
+    case ATTR_WIDTH:
+    case ATTR_DX:
+        SetWidth(atoi(value));
+        break;
+    default:
+        ControlUI::ApplyAttribute(id, name, value);
+    }
 }
 
 SIZE LabelPanelUI::EstimateSize(SIZE /*szAvailable*/)
@@ -15,7 +15,7 @@ public:
 
     virtual SIZE EstimateSize(SIZE szAvailable);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     int  m_cxWidth;
@@ -0,0 +1,142 @@
+#include "StdAfx.h"
+#include "UILayerCache.h"
+
+LayerCache::LayerCache() : hDcLayer(NULL), budget(32 * 1024 * 1024), used(0), useClock(0)
+{
+}
+
+LayerCache::~LayerCache()
+{
+    for (size_t i = 0; i < layers.Count(); i++)
+        FreeBitmap(layers.At(i));
+    if (hDcLayer)
+        ::DeleteDC(hDcLayer);
+}
+
+LayerCache::Layer *LayerCache::Find(ControlUI *ctrl)
+{
+    for (size_t i = 0; i < layers.Count(); i++) {
+        if (layers.At(i).ctrl == ctrl)
+            return &layers.At(i);
+    }
+    return NULL;
+}
+
+void LayerCache::FreeBitmap(Layer& layer)
+{
+    if (layer.bmp) {
+        ::DeleteObject(layer.bmp);
+        used -= layer.size;
+    }
+    layer.bmp = NULL;
+    layer.size = 0;
+    layer.valid = false;
+}
+
+// frees the bitmaps of the least recently painted layers until size
+// more bytes fit into the budget
+bool LayerCache::MakeRoom(size_t size)
+{
+    if (size > budget)
+        return false;
+    while (used + size > budget) {
+        Layer *oldest = NULL;
+        for (size_t i = 0; i < layers.Count(); i++) {
+            Layer& layer = layers.At(i);
+            if (layer.bmp && (!oldest || layer.lastUse < oldest->lastUse))
+                oldest = &layer;
+        }
+        if (!oldest)
+            return false;
+        FreeBitmap(*oldest);
+    }
+    return true;
+}
+
+void LayerCache::SetBudget(size_t bytes)
+{
+    budget = bytes;
+    MakeRoom(0);
+}
+
+bool LayerCache::Paint(ControlUI *ctrl, HDC hDC, const RECT& rcPaint)
+{
+    Layer *layer = Find(ctrl);
+    if (!layer || !layer->valid)
+        return false;
+    RECT rc = ctrl->GetPos();
+    if (!::EqualRect(&rc, &layer->rc))
+        return false;
+    RECT rcCopy;
+    if (::IntersectRect(&rcCopy, &rcPaint, &rc)) {
+        HBITMAP hOldBitmap = (HBITMAP) ::SelectObject(hDcLayer, layer->bmp);
+        ::BitBlt(hDC, rcCopy.left, rcCopy.top, RectDx(rcCopy), RectDy(rcCopy),
+                 hDcLayer, rcCopy.left - rc.left, rcCopy.top - rc.top, SRCCOPY);
+        ::SelectObject(hDcLayer, hOldBitmap);
+    }
+    layer->lastUse = ++useClock;
+    return true;
+}
+
+void LayerCache::Capture(ControlUI *ctrl, HDC hDC)
+{
+    RECT rc = ctrl->GetPos();
+    if (::IsRectEmpty(&rc))
+        return;
+    Layer *layer = Find(ctrl);
+    if (!layer) {
+        Layer empty = { ctrl };
+        layers.Append(empty);
+        layer = &layers.Last();
+    }
+    // assume 32 bits per pixel, the usual display format
+    size_t size = (size_t)RectDx(rc) * RectDy(rc) * 4;
+    if (layer->bmp && (RectDx(rc) != RectDx(layer->rc) || RectDy(rc) != RectDy(layer->rc)))
+        FreeBitmap(*layer);
+    if (!layer->bmp) {
+        if (!MakeRoom(size))
+            return;
+        layer->bmp = ::CreateCompatibleBitmap(hDC, RectDx(rc), RectDy(rc));
+        if (!layer->bmp)
+            return;
+        layer->size = size;
+        used += size;
+    }
+    if (!hDcLayer)
+        hDcLayer = ::CreateCompatibleDC(hDC);
+    HBITMAP hOldBitmap = (HBITMAP) ::SelectObject(hDcLayer, layer->bmp);
+    ::BitBlt(hDcLayer, 0, 0, RectDx(rc), RectDy(rc), hDC, rc.left, rc.top, SRCCOPY);
+    ::SelectObject(hDcLayer, hOldBitmap);
+    layer->rc = rc;
+    layer->valid = true;
+    layer->lastUse = ++useClock;
+}
+
+void LayerCache::Invalidate(const RECT& rc, DirtyRegion& dirty)
+{
+    for (size_t i = 0; i < layers.Count(); i++) {
+        Layer& layer = layers.At(i);
+        RECT rcTemp;
+        if (layer.valid && ::IntersectRect(&rcTemp, &rc, &layer.rc)) {
+            layer.valid = false;
+            dirty.Add(layer.rc);
+        }
+    }
+}
+
+void LayerCache::InvalidateAll()
+{
+    for (size_t i = 0; i < layers.Count(); i++)
+        layers.At(i).valid = false;
+}
+
+void LayerCache::Remove(ControlUI *ctrl)
+{
+    for (size_t i = 0; i < layers.Count(); i++) {
+        if (layers.At(i).ctrl == ctrl) {
+            FreeBitmap(layers.At(i));
+            layers.RemoveAt(i);
+            return;
+        }
+    }
+}
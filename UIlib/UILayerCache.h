@@ -0,0 +1,56 @@
+#ifndef UILayerCache_h
+#define UILayerCache_h
+
+#include "BaseUtil.h"
+#include "Vec.h"
+
+class ControlUI;
+class DirtyRegion;
+
+// The rendered pixels of the containers that are layers (see
+// ContainerUI::SetLayer()). While nothing inside a layer is invalidated,
+// painting it copies its bitmap instead of painting its whole subtree
+// again. The bitmaps stay within a memory budget: the least recently
+// painted layers lose theirs first and are painted normally until
+// they're captured again.
+class LayerCache {
+    struct Layer {
+        ControlUI * ctrl;
+        // where the pixels were captured from
+        RECT        rc;
+        HBITMAP     bmp;
+        size_t      size;
+        bool        valid;
+        UINT        lastUse;
+    };
+
+    Vec<Layer>  layers;
+    HDC         hDcLayer;
+    size_t      budget;
+    size_t      used;
+    UINT        useClock;
+
+    Layer *Find(ControlUI *ctrl);
+    void FreeBitmap(Layer& layer);
+    bool MakeRoom(size_t size);
+public:
+    LayerCache();
+    ~LayerCache();
+
+    // in bytes, 32 MB by default
+    void SetBudget(size_t bytes);
+    size_t UsedBytes() const { return used; }
+
+    // copies ctrl's pixels within rcPaint to hDC. Returns false if the
+    // layer has no valid pixels, ctrl must then be painted
+    bool Paint(ControlUI *ctrl, HDC hDC, const RECT& rcPaint);
+    // keeps the pixels of ctrl that were just painted into hDC
+    void Capture(ControlUI *ctrl, HDC hDC);
+    // the layers overlapping rc become stale. Their whole rects are added
+    // to dirty, so that the next paint covers them and can capture them
+    void Invalidate(const RECT& rc, DirtyRegion& dirty);
+    void InvalidateAll();
+    void Remove(ControlUI *ctrl);
+};
+
+#endif
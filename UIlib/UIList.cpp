@@ -88,10 +88,10 @@ void ListElementUI::Event(TEventUI& event)
     if (m_owner != NULL)  m_owner->Event(event); else ControlUI::Event(event);
 }
 
-void ListElementUI::SetAttribute(const char* name, const char* value)
+void ListElementUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "selected"))  Select();
-    else ControlUI::SetAttribute(name, value);
+    if (ATTR_SELECTED == id)  Select();
+    else ControlUI::ApplyAttribute(id, name, value);
 }
 
 ListHeaderUI::ListHeaderUI()
@@ -138,7 +138,7 @@ const char* ListHeaderItemUI::GetClass() const
 
 void ListHeaderItemUI::SetText(const char* txt)
 {
-    str::Replace(m_txt, txt);
+    GetStringPool()->Replace(m_txt, txt);
     UpdateLayout();
 }
 
@@ -148,12 +148,11 @@ void ListHeaderItemUI::SetWidth(int cxWidth)
     UpdateLayout();
 }
 
-void ListHeaderItemUI::SetAttribute(const char* name, const char* value)
+void ListHeaderItemUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else ControlUI::SetAttribute(name, value);
+    if (ATTR_WIDTH == id || ATTR_DX == id)
+        SetWidth(atoi(value));
+    else ControlUI::ApplyAttribute(id, name, value);
 }
 
 UINT ListHeaderItemUI::GetControlFlags() const
@@ -191,6 +190,7 @@ void ListHeaderItemUI::Event(TEventUI& event)
             if (RectDx(rc) > MIN_DRAGSIZE)  {
                 m_rcItem = rc;
                 m_cxWidth = RectDx(rc);
+                m_mgr->InvalidateHitTest();
                 m_ptLastMouse = event.ptMouse;
                 m_parent->Invalidate();
             }
@@ -332,6 +332,14 @@ bool ListUI::Add(ControlUI* ctrl)
     return m_list->Add(ctrl);
 }
 
+// Add() decides where an item goes and list items know their index,
+// so controls can only be appended
+bool ListUI::AddAt(ControlUI* ctrl, int idx)
+{
+    if (idx != GetCount())  return false;
+    return Add(ctrl);
+}
+
 bool ListUI::Remove(ControlUI* ctrl)
 {
     ASSERT(!"Not supported yet");
@@ -557,15 +565,21 @@ void ListUI::Scroll(int dx, int dy)
     m_list->SetScrollPos(m_list->GetScrollPos() + dy);
 }
 
-void ListUI::SetAttribute(const char* name, const char* value)
+void ListUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "header"))
+    switch (id) {
+    case ATTR_HEADER:
         GetHeader()->SetVisible(!str::Eq(value, "hidden"));
-    else if (str::Eq(name, "footer"))
+        break;
+    case ATTR_FOOTER:
         GetFooter()->SetVisible(!str::Eq(value, "hidden"));
-    else if (str::Eq(name, "expanding"))
+        break;
+    case ATTR_EXPANDING:
         SetExpanding(str::Eq(value, "true"));
-    else VerticalLayoutUI::SetAttribute(name, value);
+        break;
+    default:
+        VerticalLayoutUI::ApplyAttribute(id, name, value);
+    }
 }
 
 IListCallbackUI* ListUI::GetTextCallback() const
@@ -621,18 +635,22 @@ void ListLabelElementUI::Event(TEventUI& event)
     ListElementUI::Event(event);
 }
 
-void ListLabelElementUI::SetAttribute(const char* name, const char* value)
+void ListLabelElementUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (ParseWidth(name, value, n)) {
-        SetWidth(n);
-    } else if (str::Eq(name, "align"))  {
+    switch (id) {
+    case ATTR_WIDTH:
+    case ATTR_DX:
+        SetWidth(atoi(value));
+        break;
+    case ATTR_ALIGN:
         if (str::Find(value, "center") != NULL)
             m_uTextStyle |= DT_CENTER;
         if (str::Find(value, "right") != NULL)
             m_uTextStyle |= DT_RIGHT;
+        break;
+    default:
+        ListElementUI::ApplyAttribute(id, name, value);
     }
-    else ListElementUI::SetAttribute(name, value);
 }
 
 SIZE ListLabelElementUI::EstimateSize(SIZE /*szAvailable*/)
@@ -890,6 +908,13 @@ bool ListExpandElementUI::Add(ControlUI* ctrl)
     return m_container->Add(ctrl);
 }
 
+bool ListExpandElementUI::AddAt(ControlUI* ctrl, int idx)
+{
+    ASSERT(m_container);
+    if (m_container == NULL)  return false;
+    return m_container->AddAt(ctrl, idx);
+}
+
 bool ListExpandElementUI::Remove(ControlUI* ctrl)
 {
     ASSERT(!"Not supported yet");
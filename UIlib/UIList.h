@@ -81,7 +81,7 @@ public:
     virtual bool Activate();
 
     virtual void Event(TEventUI& event);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     int              m_idx;
@@ -117,7 +117,7 @@ public:
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
 
     void SetWidth(int cxWidth);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
     RECT GetThumbRect(RECT rc) const;
 
@@ -159,6 +159,7 @@ public:
     ControlUI* GetItem(int idx) const;
     int GetCount() const;
     bool Add(ControlUI* ctrl);
+    bool AddAt(ControlUI* ctrl, int idx);
     bool Remove(ControlUI* ctrl);
     void RemoveAll();
 
@@ -172,7 +173,7 @@ public:
 
     virtual void SetPos(RECT rc);
     virtual void Event(TEventUI& event);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
     IListCallbackUI* GetTextCallback() const;
     void SetTextCallback(IListCallbackUI* cb);
@@ -203,7 +204,7 @@ public:
 
     virtual void DrawItem(HDC hDC, const RECT& rcItem, UINT uStyle);
 
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     int  m_cxWidth;
@@ -253,6 +254,7 @@ public:
     ControlUI* GetItem(int idx) const;
     int GetCount() const;
     bool Add(ControlUI* ctrl);
+    bool AddAt(ControlUI* ctrl, int idx);
     bool Remove(ControlUI* ctrl);
     void RemoveAll();
 
@@ -4,15 +4,6 @@
 
 #include <zmouse.h>
 
-static UINT GetNameHash(const char* name)
-{
-    UINT i = 0;
-    while (*name) {
-        i = (i << 5) + i + *name++;
-    }
-    return i;
-}
-
 static UINT MapKeyState()
 {
     UINT uState = 0;
@@ -43,13 +34,8 @@ typedef struct
     bool bPickNext;
 } FINDSHORTCUT;
 
-typedef struct
-{
-    ControlUI* sender;
-    UINT       localID;
-    HWND       hWnd;
-    UINT       uWinTimer;
-} TIMERINFO;
+// the OS timer that fires the controls' timers, see SetWheelTimer()
+#define WHEEL_TIMER_ID  0x1000
 
 AnimationSpooler m_anim;
 HPEN m_hPens[UICOLOR__LAST] = { 0 };
@@ -73,7 +59,7 @@ m_hWndPaint(NULL),
     m_hDcOffscreen(NULL),
     m_hbmpOffscreen(NULL),
     m_hwndTooltip(NULL),
-    m_timerID(0x1000),
+    m_timerSet(false),
     m_root(NULL),
     m_focus(NULL),
     m_eventHover(NULL),
@@ -83,6 +69,10 @@ m_hWndPaint(NULL),
     m_focusNeeded(false),
     m_resizeNeeded(false),
     m_mouseTracking(false),
+    m_updateNesting(0),
+    m_layoutPending(false),
+    m_hitTestStale(true),
+    m_hitTestLastCtrl(NULL),
     m_offscreenPaint(true),
     m_postPaint(sizeof(TPostPaintUI))
 {
@@ -204,6 +194,7 @@ m_hWndPaint(NULL),
     m_szMinWindow.cx = 140;
     m_szMinWindow.cy = 200;
     m_ptLastMousePos.x = m_ptLastMousePos.y = -1;
+    m_hitTestLastPt.x = m_hitTestLastPt.y = -1;
     m_uMsgMouseWheel = ::RegisterWindowMessage(MSH_MOUSEWHEEL);
     // System Config
     m_SystemConfig.bShowKeyboardCues = false;
@@ -219,8 +210,6 @@ PaintManagerUI::~PaintManagerUI()
     for (i = 0; i < m_delayedCleanup.GetSize(); i++)
         delete static_cast<ControlUI*>(m_delayedCleanup[i]);
     delete m_root;
-    // Release other collections
-    for (i = 0; i < m_timers.GetSize(); i++)  delete static_cast<TIMERINFO*>(m_timers[i]);
     // Reset other parts...
     ::DestroyWindow(m_hwndTooltip);
     ::DeleteDC(m_hDcOffscreen);
@@ -298,6 +287,7 @@ bool PaintManagerUI::PreMessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam,
             if (wParam == VK_TAB)  {
                 SetNextTabControl(::GetKeyState(VK_SHIFT) >= 0);
                 m_SystemConfig.bShowKeyboardCues = true;
+                m_layers.InvalidateAll();
                 ::InvalidateRect(m_hWndPaint, NULL, FALSE);
                 return true;
             }
@@ -340,6 +330,7 @@ bool PaintManagerUI::PreMessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam,
             // Press ALT once and the shortcuts will be shown in view
             if (wParam == VK_MENU && !m_SystemConfig.bShowKeyboardCues)  {
                 m_SystemConfig.bShowKeyboardCues = true;
+                m_layers.InvalidateAll();
                 ::InvalidateRect(m_hWndPaint, NULL, FALSE);
             }
             if (m_focus != NULL)  {
@@ -422,6 +413,7 @@ bool PaintManagerUI::MessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam, LRE
         return true;
     case WM_PAINT:
         {
+            FlushDirtyRegion();
             // Should we paint?
             RECT rcPaint = { 0 };
             if (!::GetUpdateRect(m_hWndPaint, &rcPaint, FALSE))  return true;
@@ -455,6 +447,9 @@ bool PaintManagerUI::MessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam, LRE
             if (m_focusNeeded)  {
                 SetNextTabControl();
             }
+            // The layout and the focus change invalidated more controls. The
+            // paint below covers these rects only once they're flushed.
+            FlushDirtyRegion();
 
             // Render screen
             if (m_anim.IsAnimating()) 
@@ -576,17 +571,9 @@ bool PaintManagerUI::MessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam, LRE
         return true;
     case WM_TIMER:
         {
-            for (int i = 0; i < m_timers.GetSize(); i++)  {
-                const TIMERINFO* timer = static_cast<TIMERINFO*>(m_timers[i]);
-                if (timer->hWnd == m_hWndPaint && timer->uWinTimer == LOWORD(wParam))  {
-                    TEventUI event = { 0 };
-                    event.type = UIEVENT_TIMER;
-                    event.wParam = timer->localID;
-                    event.timestamp = ::GetTickCount();
-                    timer->sender->Event(event);
-                    break;
-                }
-            }
+            if (wParam != WHEEL_TIMER_ID)  break;
+            m_timers.Advance(::GetTickCount(), __OnTimer, NULL);
+            SetWheelTimer();
         }
         break;
     case WM_MOUSEHOVER:
@@ -872,13 +859,81 @@ bool PaintManagerUI::MessageHandler(UINT uMsg, WPARAM wParam, LPARAM lParam, LRE
 
 void PaintManagerUI::UpdateLayout()
 {
+    InvalidateHitTest();
+    if (m_updateNesting > 0)  {
+        m_layoutPending = true;
+        return;
+    }
     m_resizeNeeded = true;
     ::InvalidateRect(m_hWndPaint, NULL, FALSE);
 }
 
 void PaintManagerUI::Invalidate(RECT rcItem)
 {
-    ::InvalidateRect(m_hWndPaint, &rcItem, FALSE);
+    // The first rect goes to Windows right away so that a WM_PAINT gets
+    // queued, the rest wait for it. A relayout invalidates every control
+    // it moves, which adds up to a handful of rects this way.
+    if (m_dirty.IsEmpty())  ::InvalidateRect(m_hWndPaint, &rcItem, FALSE);
+    m_dirty.Add(rcItem);
+    // a layer with something changed inside is painted whole once, so
+    // that its pixels can be kept again
+    m_layers.Invalidate(rcItem, m_dirty);
+}
+
+void PaintManagerUI::PaintControl(ControlUI* ctrl, HDC hDC, const RECT& rcPaint)
+{
+    if (!ctrl->IsLayer())  {
+        ctrl->DoPaint(hDC, rcPaint);
+        return;
+    }
+    if (m_layers.Paint(ctrl, hDC, rcPaint))  return;
+    ctrl->DoPaint(hDC, rcPaint);
+    // Only the pixels painted just now are current, the rest of the
+    // offscreen bitmap is left from earlier frames. The layer is kept if
+    // all of it was painted and isn't clipped by its parents.
+    if (hDC != m_hDcOffscreen)  return;
+    RECT rcClip = { 0 };
+    ::GetClipBox(hDC, &rcClip);
+    RECT rcPainted = { 0 };
+    ::IntersectRect(&rcPainted, &rcPaint, &rcClip);
+    RECT rc = ctrl->GetPos();
+    RECT rcUnion = { 0 };
+    ::UnionRect(&rcUnion, &rcPainted, &rc);
+    if (::EqualRect(&rcUnion, &rcPainted))  m_layers.Capture(ctrl, hDC);
+}
+
+void PaintManagerUI::SetLayerBudget(size_t bytes)
+{
+    m_layers.SetBudget(bytes);
+}
+
+void PaintManagerUI::DropLayer(ControlUI* ctrl)
+{
+    m_layers.Remove(ctrl);
+}
+
+void PaintManagerUI::FlushDirtyRegion()
+{
+    for (size_t i = 0; i < m_dirty.Count(); i++)  {
+        RECT rc = m_dirty.At(i);
+        ::InvalidateRect(m_hWndPaint, &rc, FALSE);
+    }
+    m_dirty.Reset();
+}
+
+void PaintManagerUI::BeginUpdate()
+{
+    m_updateNesting++;
+}
+
+void PaintManagerUI::EndUpdate()
+{
+    ASSERT(m_updateNesting > 0);
+    if (--m_updateNesting > 0)  return;
+    if (m_layoutPending)  {
+        m_layoutPending = false;
+        UpdateLayout();
+    }
 }
 
 bool PaintManagerUI::AttachDialog(ControlUI* ctrl)
@@ -889,17 +944,19 @@ bool PaintManagerUI::AttachDialog(ControlUI* ctrl)
     m_eventKey = NULL;
     m_eventHover = NULL;
     m_eventClick = NULL;
-    m_nameHash.Empty();
     // Remove the existing control-tree. We might have gotten inside this function as
     // a result of an event fired or similar, so we cannot just delete the objects and
     // pull the internal memory of the calling code. We'll delay the cleanup.
     if (m_root != NULL)  {
+        // its controls must not be found by name until then
+        m_root->FindControl(__RemoveFromNameIndex, this, UIFIND_ALL);
         m_delayedCleanup.Add(m_root);
         ::PostMessage(m_hWndPaint, WM_APP + 1, 0, 0L);
     }
     // Set the dialog root element
     m_root = ctrl;
     // Go ahead...
+    InvalidateHitTest();
     m_resizeNeeded = true;
     m_firstLayout = true;
     m_focusNeeded = true;
@@ -912,9 +969,6 @@ bool PaintManagerUI::InitControls(ControlUI* ctrl, ControlUI* parent /*= NULL*/)
     ASSERT(ctrl);
     if (ctrl == NULL)  return false;
     ctrl->SetManager(this, parent != NULL ? parent : ctrl->GetParent());
-    // We're usually initializing the control after adding some more of them to the tree,
-    // and thus this would be a good time to request the name-map rebuilt.
-    m_nameHash.Empty();
     return true;
 }
 
@@ -923,8 +977,30 @@ void PaintManagerUI::ReapObjects(ControlUI* ctrl)
     if (ctrl == m_eventKey)  m_eventKey = NULL;
     if (ctrl == m_eventHover)  m_eventHover = NULL;
     if (ctrl == m_eventClick)  m_eventClick = NULL;
-    // TODO: Do something with name-hash-map
-    //m_nameHash.Empty();
+    if (ctrl == m_focus)  m_focus = NULL;
+    RemoveFromNameIndex(ctrl);
+    m_layers.Remove(ctrl);
+    m_timers.KillAll(ctrl);
+    if (m_timerSet && m_timers.Count() == 0)  SetWheelTimer();
+    InvalidateHitTest();
+}
+
+void PaintManagerUI::InvalidateHitTest()
+{
+    m_hitTestStale = true;
+    // the memo could name a control that's gone or belongs to an old root
+    m_hitTestLastPt.x = m_hitTestLastPt.y = -1;
+    m_hitTestLastCtrl = NULL;
+}
+
+void PaintManagerUI::AddToNameIndex(ControlUI* ctrl)
+{
+    m_names.Add(ctrl);
+}
+
+void PaintManagerUI::RemoveFromNameIndex(ControlUI* ctrl)
+{
+    m_names.Remove(ctrl);
 }
 
 void PaintManagerUI::MessageLoop()
@@ -1012,32 +1088,40 @@ bool PaintManagerUI::SetTimer(ControlUI* ctrl, UINT timerID, UINT uElapse)
 {
     ASSERT(ctrl!=NULL);
     ASSERT(uElapse>0);
-    m_timerID = (++m_timerID) % 0xFF;
-    if (!::SetTimer(m_hWndPaint, m_timerID, uElapse, NULL))  return FALSE;
-    TIMERINFO* timer = new TIMERINFO;
-    if (timer == NULL)  return FALSE;
-    timer->hWnd = m_hWndPaint;
-    timer->sender = ctrl;
-    timer->localID = timerID;
-    timer->uWinTimer = m_timerID;
-    return m_timers.Add(timer);
+    if (!m_timers.Set(ctrl, timerID, uElapse, ::GetTickCount()))  return false;
+    return SetWheelTimer();
 }
 
 bool PaintManagerUI::KillTimer(ControlUI* ctrl, UINT timerID)
 {
     ASSERT(ctrl!=NULL);
-    for (int i = 0; i< m_timers.GetSize(); i++)  {
-        TIMERINFO* timer = static_cast<TIMERINFO*>(m_timers[i]);
-        if (timer->sender == ctrl
-            && timer->hWnd == m_hWndPaint
-            && timer->localID == timerID) 
-        {
-            ::KillTimer(timer->hWnd, timer->uWinTimer);
-            delete timer;
-            return m_timers.Remove(i);
-        }
+    if (!m_timers.Kill(ctrl, timerID))  return false;
+    // an early WM_TIMER does no harm, the OS timer only has to go once
+    // there are no timers left
+    if (m_timers.Count() == 0)  SetWheelTimer();
+    return true;
+}
+
+// sets the OS timer to when the next control timer might be due
+bool PaintManagerUI::SetWheelTimer()
+{
+    UINT delay = 0;
+    if (!m_timers.NextDue(::GetTickCount(), &delay))  {
+        if (m_timerSet)  ::KillTimer(m_hWndPaint, WHEEL_TIMER_ID);
+        m_timerSet = false;
+        return true;
     }
-    return false;
+    m_timerSet = ::SetTimer(m_hWndPaint, WHEEL_TIMER_ID, delay, NULL) != 0;
+    return m_timerSet;
+}
+
+void PaintManagerUI::__OnTimer(ControlUI* ctrl, UINT timerID, void* /*data*/)
+{
+    TEventUI event = { 0 };
+    event.type = UIEVENT_TIMER;
+    event.wParam = timerID;
+    event.timestamp = ::GetTickCount();
+    ctrl->Event(event);
 }
 
 bool PaintManagerUI::SetNextTabControl(bool bForward)
@@ -1207,39 +1291,28 @@ bool PaintManagerUI::GetThemeColorPair(UITYPE_COLOR idx, COLORREF& clr1, COLORRE
 
 ControlUI* PaintManagerUI::FindControl(const char* name)
 {
-    ASSERT(m_root);
-    // First time here? Build hash array...
-    if (m_nameHash.GetSize() == 0)  {
-        int nCount = 0;
-        m_root->FindControl(__FindControlFromCount, &nCount, UIFIND_ALL);
-        m_nameHash.EnsureCap(nCount + (nCount / 10));
-        m_root->FindControl(__FindControlFromNameHash, this, UIFIND_ALL);
-    }
-    // Find name in the hash array
-    int nCount = 0;
-    int nSize = m_nameHash.GetSize();
-    int iNameHash = (int) (GetNameHash(name) % nSize);
-    while (m_nameHash[iNameHash] != NULL)  {
-        const char *ctrlName = m_nameHash[iNameHash]->GetName();
-        if (str::Eq(ctrlName, name))
-            return m_nameHash[iNameHash];
-        iNameHash = (iNameHash + 1) % nSize;
-        if (++nCount >= nSize)  break;
-    }
-    return NULL;
+    return m_names.Find(name);
 }
 
 ControlUI* PaintManagerUI::FindControl(POINT pt) const
 {
     ASSERT(m_root);
-    return m_root->FindControl(__FindControlFromPoint, &pt, UIFIND_VISIBLE | UIFIND_HITTEST);
-}
-
-ControlUI* CALLBACK PaintManagerUI::__FindControlFromCount(ControlUI* /*pThis*/, void* data)
-{
-    int* pnCount = static_cast<int*>(data);
-    (*pnCount)++;
-    return NULL;  // Count all controls
+    if (m_hitTestStale)  {
+        m_hitTest.Reset();
+        m_root->FindControl(__AddToHitTest, &m_hitTest, UIFIND_VISIBLE);
+        // out of memory, fall back to walking the tree
+        if (!m_hitTest.Build())  return m_root->FindControl(__FindControlFromPoint, &pt, UIFIND_VISIBLE | UIFIND_HITTEST);
+        m_hitTestStale = false;
+#ifdef _DEBUG
+        CheckHitTest();
+#endif
+    } else if (pt.x == m_hitTestLastPt.x && pt.y == m_hitTestLastPt.y)  {
+        return m_hitTestLastCtrl;
+    }
+    m_hitTestLastPt = pt;
+    m_hitTestLastCtrl = m_hitTest.Find(pt);
+    ASSERT(m_hitTestLastCtrl == m_root->FindControl(__FindControlFromPoint, &pt, UIFIND_VISIBLE | UIFIND_HITTEST));
+    return m_hitTestLastCtrl;
 }
 
 ControlUI* CALLBACK PaintManagerUI::__FindControlFromTab(ControlUI* pThis, void* data)
@@ -1256,22 +1329,10 @@ ControlUI* CALLBACK PaintManagerUI::__FindControlFromTab(ControlUI* pThis, void*
     return NULL;  // Examine all controls
 }
 
-ControlUI* CALLBACK PaintManagerUI::__FindControlFromNameHash(ControlUI* pThis, void* data)
+ControlUI* CALLBACK PaintManagerUI::__RemoveFromNameIndex(ControlUI* pThis, void* data)
 {
-    PaintManagerUI* manager = static_cast<PaintManagerUI*>(data);
-    // No name?
-    const char *name = pThis->GetName();
-    if (NULL == name)  return NULL;
-    // Add this control to the hash list
-    int nCount = 0;
-    int nSize = manager->m_nameHash.GetSize();
-    int iNameHash = (int) (GetNameHash(name) % nSize);
-    while (manager->m_nameHash[iNameHash] != NULL)  {
-        iNameHash = (iNameHash + 1) % nSize;
-        if (++nCount == nSize)  return NULL;
-    }
-    manager->m_nameHash.InsertAt(iNameHash, pThis);
-    return NULL; // Attempt to add all controls
+    static_cast<PaintManagerUI*>(data)->RemoveFromNameIndex(pThis);
+    return NULL;  // Remove all controls
 }
 
 ControlUI* CALLBACK PaintManagerUI::__FindControlFromShortcut(ControlUI* pThis, void* data)
@@ -1288,6 +1349,45 @@ ControlUI* CALLBACK PaintManagerUI::__FindControlFromPoint(ControlUI* pThis, voi
     return ::PtInRect(&pThis->GetPos(), *pPoint) ? pThis : NULL;
 }
 
+// A hit test walk only gets to a control if the point is inside all of its
+// ancestors, so each control is added with its rect clipped by theirs.
+// The walk visits the controls in the same order as a hit test does.
+// ListExpandElementUI goes into its sub-item container without checking
+// its own rect, but that container's parent is the element's parent, not
+// the element, so the element's rect doesn't clip the sub-items here either
+ControlUI* CALLBACK PaintManagerUI::__AddToHitTest(ControlUI* pThis, void* data)
+{
+    HitTestGrid* grid = static_cast<HitTestGrid*>(data);
+    RECT rc = pThis->GetPos();
+    for (ControlUI* parent = pThis->GetParent(); parent != NULL; parent = parent->GetParent())  {
+        RECT rcParent = parent->GetPos();
+        if (!::IntersectRect(&rc, &rc, &rcParent))  return NULL;
+    }
+    grid->Add(pThis, rc);
+    return NULL;  // Examine all controls
+}
+
+#ifdef _DEBUG
+// Compares the rebuilt grid with a hit test walk at random points of the
+// dialog, not only where the mouse goes, to catch controls whose
+// FindControl() doesn't clip their children the way __AddToHitTest() assumes
+void PaintManagerUI::CheckHitTest() const
+{
+    RECT rc = m_root->GetPos();
+    int cx = rc.right - rc.left, cy = rc.bottom - rc.top;
+    if (cx <= 0 || cy <= 0)  return;
+    // our own generator, so that debug builds don't change rand()'s sequence
+    static UINT seed = 1;
+    for (int i = 0; i < 256; i++)  {
+        seed = seed * 1103515245 + 12345;
+        POINT pt = { rc.left + (int)((seed >> 8) % (UINT)cx), 0 };
+        seed = seed * 1103515245 + 12345;
+        pt.y = rc.top + (int)((seed >> 8) % (UINT)cy);
+        ASSERT(m_hitTest.Find(pt) == m_root->FindControl(__FindControlFromPoint, &pt, UIFIND_VISIBLE | UIFIND_HITTEST));
+    }
+}
+#endif
+
 ControlUI::ControlUI() : 
 m_mgr(NULL), 
     m_parent(NULL), 
@@ -1300,7 +1400,11 @@ m_mgr(NULL),
     m_bgCol(-1),
     m_visible(true), 
     m_focused(false),
-    m_enabled(true)
+    m_enabled(true),
+    m_layer(false),
+    m_nameNext(NULL),
+    m_namePrev(NULL),
+    m_nameIndexed(false)
 {
     ::ZeroMemory(&m_rcItem, sizeof(RECT));
 }
@@ -1308,9 +1412,34 @@ m_mgr(NULL),
 ControlUI::~ControlUI()
 {
     if (m_mgr != NULL)  m_mgr->ReapObjects(this);
-    free((void*)m_name);
-    free((void*)m_txt);
-    free((void*)m_toolTip);
+    StringPool* pool = GetStringPool();
+    pool->Release(m_name);
+    pool->Release(m_txt);
+    pool->Release(m_toolTip);
+}
+
+StringPool* ControlUI::GetStringPool()
+{
+    // never freed, so that controls destroyed during static destruction
+    // can still release their strings
+    static StringPool* pool = NULL;
+    if (pool == NULL)  pool = new StringPool();
+    return pool;
+}
+
+void* ControlUI::operator new(size_t size)
+{
+    return ControlArena::Alloc(size);
+}
+
+void ControlUI::operator delete(void* p)
+{
+    ControlArena::Free(p);
+}
+
+bool ControlUI::IsLayer() const
+{
+    return m_layer;
 }
 
 bool ControlUI::IsVisible() const
@@ -1380,7 +1509,7 @@ const char * ControlUI::GetText() const
 
 void ControlUI::SetText(const char* txt)
 {
-    str::Replace(m_txt, txt);
+    GetStringPool()->Replace(m_txt, txt);
     Invalidate();
 }
 
@@ -1396,7 +1525,7 @@ void ControlUI::SetTag(UINT_PTR pTag)
 
 void ControlUI::SetToolTip(const char* txt)
 {
-    str::Replace(m_toolTip, txt);
+    GetStringPool()->Replace(m_toolTip, txt);
 }
 
 const char* ControlUI::GetToolTip() const
@@ -1416,8 +1545,10 @@ PaintManagerUI* ControlUI::GetManager() const
 void ControlUI::SetManager(PaintManagerUI* manager, ControlUI* parent)
 {
     bool bInit = (m_mgr == NULL);
+    if (m_mgr != NULL && m_mgr != manager)  m_mgr->RemoveFromNameIndex(this);
     m_mgr = manager;
     m_parent = parent;
+    if (m_mgr != NULL)  m_mgr->AddToNameIndex(this);
     if (bInit)
         Init();
 }
@@ -1429,7 +1560,10 @@ const char* ControlUI::GetName() const
 
 void ControlUI::SetName(const char* name)
 {
-    str::Replace(m_name, name);
+    // the index is keyed by the name
+    if (m_mgr != NULL)  m_mgr->RemoveFromNameIndex(this);
+    GetStringPool()->Replace(m_name, name);
+    if (m_mgr != NULL)  m_mgr->AddToNameIndex(this);
 }
 
 void* ControlUI::GetInterface(const char* name)
@@ -1455,6 +1589,7 @@ RECT ControlUI::GetPos() const
 void ControlUI::SetPos(RECT rc)
 {
     m_rcItem = rc;
+    if (m_mgr != NULL)  m_mgr->InvalidateHitTest();
     // NOTE: SetPos() is usually called during the WM_PAINT cycle where all controls are
     //       being laid out. Calling UpdateLayout() again would be wrong. Refreshing the
     //       window won't hurt (if we're already inside WM_PAINT we'll just validate it out).
@@ -1536,7 +1671,17 @@ void ControlUI::SetBgColorAttribute(const char *name)
 
 void ControlUI::SetAttribute(const char* name, const char* value)
 {
-    if (str::EqI(name, "pos"))  {
+    ApplyAttribute(AttrIdFromName(name), name, value);
+}
+
+void ControlUI::ApplyAttribute(AttrId id, const char* name, const char* value)
+{
+    // names of ControlUI attributes are case-insensitive
+    if (ATTR_UNKNOWN == id)
+        id = AttrIdFromName(name, true);
+
+    switch (id) {
+    case ATTR_POS: {
         RECT rcPos = { 0 };
         char* pstr = NULL;
         rcPos.left = strtol(value, &pstr, 10);      ASSERT(pstr);    
@@ -1544,15 +1689,21 @@ void ControlUI::SetAttribute(const char* name, const char* value)
         rcPos.right = strtol(pstr + 1, &pstr, 10);  ASSERT(pstr);    
         rcPos.bottom = strtol(pstr + 1, &pstr, 10); ASSERT(pstr);    
         SetPos(rcPos);
+        break;
     }
-    else if (str::EqI(name, "name"))     SetName(value);
-    else if (str::EqI(name, "text"))     SetText(value);
-    else if (str::EqI(name, "tooltip"))  SetToolTip(value);
-    else if (str::EqI(name, "enabled"))  SetEnabled(str::Eq(value, "true"));
-    else if (str::EqI(name, "visible"))  SetVisible(str::Eq(value, "true"));
-    else if (str::EqI(name, "shortcut")) SetShortcut(value[0]);
-    else if (str::EqI(name, "bgCol") || str::EqI(name, "backColor"))
+    case ATTR_NAME:     SetName(value); break;
+    case ATTR_TEXT:     SetText(value); break;
+    case ATTR_TOOLTIP:  SetToolTip(value); break;
+    case ATTR_ENABLED:  SetEnabled(str::Eq(value, "true")); break;
+    case ATTR_VISIBLE:  SetVisible(str::Eq(value, "true")); break;
+    case ATTR_SHORTCUT: SetShortcut(value[0]); break;
+    case ATTR_BGCOL:
+    case ATTR_BACKCOLOR:
         SetBgColorAttribute(value);
+        break;
+    default:
+        break;
+    }
 }
 
 // handle xml attribute lists in the form:
@@ -258,7 +258,20 @@ public:
 public:
     void Init(HWND hWnd);
     void UpdateLayout();
+    // the rect is only collected in m_dirty, which is handed to Windows
+    // once per frame when WM_PAINT arrives
     void Invalidate(RECT rcItem);
+    // paints ctrl, from the pixels kept for it if it's a layer that
+    // nothing inside of was invalidated since (see ContainerUI::SetLayer())
+    void PaintControl(ControlUI* ctrl, HDC hDC, const RECT& rcPaint);
+    // the memory all layers together may keep, in bytes
+    void SetLayerBudget(size_t bytes);
+    void DropLayer(ControlUI* ctrl);
+    // Between BeginUpdate() and the matching EndUpdate() controls can be
+    // added without each of them invalidating the window, that's done
+    // once by the outermost EndUpdate()
+    void BeginUpdate();
+    void EndUpdate();
 
     HDC GetPaintDC() const;
     HWND GetPaintWindow() const;
@@ -284,12 +297,21 @@ public:
     bool AttachDialog(ControlUI* ctrl);
     bool InitControls(ControlUI* ctrl, ControlUI* parent = NULL);
     void ReapObjects(ControlUI* ctrl);
+    // keep FindControl(name) up to date, called by the controls when they
+    // get a manager or a new name
+    void AddToNameIndex(ControlUI* ctrl);
+    void RemoveFromNameIndex(ControlUI* ctrl);
+    // called when controls move, appear or disappear
+    void InvalidateHitTest();
 
     ControlUI* GetFocus() const;
     void SetFocus(ControlUI* ctrl);
 
     bool SetNextTabControl(bool bForward = true);
 
+    // The timers of all controls are multiplexed on a single OS timer, set
+    // to when the next of them is due. Setting a timer that's already set
+    // restarts it.
     bool SetTimer(ControlUI* ctrl, UINT timerID, UINT uElapse);
     bool KillTimer(ControlUI* ctrl, UINT timerID);
 
@@ -304,7 +326,14 @@ public:
     bool AddAnimJob(const AnimJobUI& job);
     bool AddPostPaintBlit(const TPostPaintUI& job);
 
+    // answered from m_hitTest, which is rebuilt on the first call after
+    // InvalidateHitTest(). WM_SETCURSOR, WM_MOUSEHOVER and the button
+    // messages usually ask again for the point of the last WM_MOUSEMOVE,
+    // that answer is reused
     ControlUI* FindControl(POINT pt) const;
+    // Of several controls with the same name, returns the one that got its
+    // manager or its name first. For a dialog attached at once that's the
+    // first one FindControl(FINDCONTROLPROC) visits.
     ControlUI* FindControl(const char* name);
 
     static void MessageLoop();
@@ -318,11 +347,17 @@ public:
     void SetSystemSettings(const TSystemSettingsUI Config);
 
 private:
-    static ControlUI* CALLBACK __FindControlFromNameHash(ControlUI* pThis, void* data);
-    static ControlUI* CALLBACK __FindControlFromCount(ControlUI* pThis, void* data);
+    void FlushDirtyRegion();
+    static ControlUI* CALLBACK __RemoveFromNameIndex(ControlUI* pThis, void* data);
     static ControlUI* CALLBACK __FindControlFromPoint(ControlUI* pThis, void* data);
+    static ControlUI* CALLBACK __AddToHitTest(ControlUI* pThis, void* data);
+#ifdef _DEBUG
+    void CheckHitTest() const;
+#endif
     static ControlUI* CALLBACK __FindControlFromTab(ControlUI* pThis, void* data);
     static ControlUI* CALLBACK __FindControlFromShortcut(ControlUI* pThis, void* data);
+    static void __OnTimer(ControlUI* ctrl, UINT timerID, void* data);
+    bool SetWheelTimer();
 
 private:
     HWND     m_hWndPaint;
@@ -341,19 +376,34 @@ private:
     POINT m_ptLastMousePos;
     SIZE m_szMinWindow;
     UINT m_uMsgMouseWheel;
-    UINT m_timerID;
+    // the OS timer m_timers share is running
+    bool m_timerSet;
     bool m_firstLayout;
     bool m_resizeNeeded;
     bool m_focusNeeded;
     bool m_offscreenPaint;
     bool m_mouseTracking;
+    // see BeginUpdate()
+    int m_updateNesting;
+    bool m_layoutPending;
 
     TSystemMetricsUI m_SystemMetrics;
     TSystemSettingsUI m_SystemConfig;
 
     Vec<INotifyUI*> m_notifiers;
-    Vec<ControlUI*> m_nameHash;
-    StdPtrArray m_timers;
+    // the controls with a name, see FindControl(name)
+    NameIndex<ControlUI> m_names;
+    // the visible controls' rects clipped by their ancestors', see FindControl(POINT)
+    mutable HitTestGrid m_hitTest;
+    mutable bool m_hitTestStale;
+    mutable POINT m_hitTestLastPt;
+    mutable ControlUI* m_hitTestLastCtrl;
+    // the rects invalidated since the last WM_PAINT, see Invalidate()
+    DirtyRegion m_dirty;
+    // the pixels of the layers, see PaintControl()
+    LayerCache m_layers;
+    // the timers of all controls, see SetTimer()
+    TimerWheel m_timers;
     StdValArray m_postPaint;
     StdPtrArray m_messageFilters;
     StdPtrArray m_delayedCleanup;
@@ -367,14 +417,27 @@ typedef ControlUI* (CALLBACK* FINDCONTROLPROC)(ControlUI*, void*);
 
 class UILIB_API ControlUI : public INotifyUI
 {
+    friend PaintManagerUI;
+    friend class NameIndex<ControlUI>;
 public:
     ControlUI();
     virtual ~ControlUI();
 
+    // controls come from the current ControlArena, if there's one
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
+    // holds the name, text and tooltip of all controls, so that controls
+    // with the same label share a single copy of it
+    static StringPool* GetStringPool();
+
 public:
     const char* GetName() const;
     void        SetName(const char* name);
 
+    // see ContainerUI::SetLayer()
+    bool IsLayer() const;
+
     virtual void* GetInterface(const char* name);
 
     virtual bool Activate();
@@ -417,8 +480,15 @@ public:
     virtual void Event(TEventUI& event);
     virtual void Notify(TNotifyUI& msg);
 
-    virtual void SetAttribute(const char* name, const char* value);
+    // resolves name to an AttrId and calls ApplyAttribute(). Not virtual
+    // because the dialog builders call ApplyAttribute() directly, so
+    // controls must override ApplyAttribute() to see every attribute
+    void SetAttribute(const char* name, const char* value);
     ControlUI* ApplyAttributeList(const char* attrList);
+    // controls handle the attribute ids they know and pass everything else
+    // to their base class. Attributes not known to the library have
+    // id ATTR_UNKNOWN and must be recognized by name
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
     virtual const char* GetClass() const = 0;
     virtual SIZE EstimateSize(SIZE szAvailable) = 0;
@@ -445,6 +515,12 @@ protected:
     bool             m_visible;
     bool             m_enabled;
     bool             m_focused;
+    bool             m_layer;
+
+    // see NameIndex
+    ControlUI*       m_nameNext;
+    ControlUI*       m_namePrev;
+    bool             m_nameIndexed;
 };
 
 #endif // !defined(AFX_UICONTROLS_H__20050423_DB94_1D69_A896_0080AD509054__INCLUDED_)
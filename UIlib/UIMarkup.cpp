@@ -1,38 +1,126 @@
 #include "UIMarkup.h"
 #include "StrUtil.h"
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
+struct XmlNestingInfo {
+    char *  name;
+    int     nodeIdx;
+};
+
+// nodes [start, end) are the content of a Template node
+struct MarkupTemplate {
+    const char *    name;
+    size_t          start;
+    size_t          end;
+};
+
+// Repeat nodes can refer to templates which contain Repeat nodes, this
+// stops a template that (indirectly) refers to itself
+#define MAX_REPEAT_NESTING 32
+// bounds the work malformed or hostile markup can cause: count="2000000000"
+// would otherwise loop (and without a callback allocate) that many times,
+// and nested Repeat nodes multiply their counts. Every copy of a Repeat's
+// content and every node or directive copied counts against
+// MAX_EXPANDED_NODES, so that nested Repeats which produce no nodes are
+// bounded as well
+#define MAX_REPEAT_COUNT   100000
+#define MAX_EXPANDED_NODES (1024 * 1024)
+
 class ParserState
 {
 public:
-    ParserState(const char *s, MarkupParserCallback *cb) {
-        this->txt = str::Dup(s);
+    // the parser modifies the text it parses. If ownsTxt is true, s is
+    // a private copy freed when we're done, otherwise it's a buffer
+    // owned by the caller and we parse it in place. Without a callback
+    // (for MarkupCursor) all nodes are kept and the reported ones are
+    // listed in reported
+    ParserState(char *s, bool ownsTxt, MarkupParserCallback *cb) {
+        this->txt = s;
+        this->ownsTxt = ownsTxt;
         this->curr = this->txt;
         this->cb = cb;
+        this->lazyAttributes = cb ? cb->WantsLazyAttributes() : true;
+        this->xmlParentIdx = -1;
+        this->directiveIdx = -1;
+        this->repeatNesting = 0;
+        this->expandedCount = 0;
     }
 
-    ~ParserState() { 
-        for (size_t i=0; i<nodes.Count(); i++) {
-            delete nodes.At(i).attributes;
-        }
-        free(txt);
+    ~ParserState() {
+        if (ownsTxt)
+            free(txt);
+        FreeVecMembers(blocks);
     }
 
-    MarkupNode *AllocNode(int& idx, int parentIdx) {
+    MarkupNode *AllocNode(int& idx, int parentIdx, size_t attributesStart, size_t attributesCount, char *rawAttributes=NULL) {
         idx = nodes.Count();
         MarkupNode *ret = nodes.MakeSpaceAt(idx);
         ret->parserState = this;
         ret->parentIdx = parentIdx;
+        ret->attributesStart = attributesStart;
+        ret->attributesCount = attributesCount;
+        ret->rawAttributes = rawAttributes;
         return ret;
     }
 
+    void DecodeAttributes(MarkupNode *node);
+
+    void Report(int idx) {
+        if (cb)
+            cb->NewNode(Node(idx));
+        else
+            reported.Append(idx);
+    }
+
+    int AddNode(char *name, int parentIdx, size_t attributesStart, size_t attributesCount, char *rawAttributes=NULL);
+    bool CloseNode(int idx);
+    bool ExpandRepeat(int repeatIdx, size_t end, int parentIdx);
+    bool Expand(size_t start, size_t end, int parentIdx);
+
     MarkupNode *Node(int idx) {
         return &nodes.At(idx);
     }
 
+    // attributes of all nodes are stored as consecutive name/value
+    // pairs in a single array, so that we don't have to allocate
+    // a separate array for every node
+    void AppendAttribute(char *name, char *value) {
+        attributes.Append(name);
+        attributes.Append(value);
+    }
+
+    size_t AttributesEnd() const {
+        return attributes.Count() / 2;
+    }
+
     char *                  txt;
+    bool                    ownsTxt;
     char *                  curr;
-    Vec<MarkupNode>        nodes;
+    Vec<MarkupNode>         nodes;
+    Vec<char*>              attributes;
     MarkupParserCallback *  cb;
+    Vec<int>                reported;
+    // if true, xml attributes are only split when they're asked for
+    bool                    lazyAttributes;
+
+    // xml nesting is part of the state so that parsing can be resumed
+    // when the text arrives in chunks (see MarkupXmlStreamParser)
+    Vec<XmlNestingInfo>     xmlStack;
+    int                     xmlParentIdx;
+    // text of the chunks, nodes point inside them
+    Vec<char*>              blocks;
+
+    // outermost open Template or Repeat node, -1 if none. Nodes inside
+    // it are kept as prototypes and only reported when expanded
+    int                     directiveIdx;
+    Vec<MarkupTemplate>     templates;
+    int                     repeatNesting;
+    // copies and copied nodes so far, see MAX_EXPANDED_NODES
+    size_t                  expandedCount;
 };
 
 MarkupNode *MarkupNode::Parent()
@@ -42,6 +130,40 @@ MarkupNode *MarkupNode::Parent()
     return NULL;
 }
 
+size_t MarkupNode::AttributesCount() const
+{
+    if (rawAttributes)
+        parserState->DecodeAttributes((MarkupNode*)this);
+    return attributesCount;
+}
+
+const char *MarkupNode::AttributeName(size_t idx) const
+{
+    if (rawAttributes)
+        parserState->DecodeAttributes((MarkupNode*)this);
+    assert(idx < attributesCount);
+    return parserState->attributes.At((attributesStart + idx) * 2);
+}
+
+const char *MarkupNode::AttributeValue(size_t idx) const
+{
+    if (rawAttributes)
+        parserState->DecodeAttributes((MarkupNode*)this);
+    assert(idx < attributesCount);
+    return parserState->attributes.At((attributesStart + idx) * 2 + 1);
+}
+
+// returns NULL if the node has no attribute with this name
+const char *MarkupNode::GetAttribute(const char *name) const
+{
+    size_t n = AttributesCount();
+    for (size_t i = 0; i < n; i++) {
+        if (str::Eq(AttributeName(i), name))
+            return AttributeValue(i);
+    }
+    return NULL;
+}
+
 enum XmlTagType {
     TAG_INVALID,
     TAG_OPEN,           // <foo>
@@ -51,15 +173,105 @@ enum XmlTagType {
 
 class XmlTagInfo {
 public:
-    XmlTagInfo() : type(TAG_INVALID), name(NULL), attributes(NULL) {}
-    // we assume that the ownership of only data XmlTagInfo owns (attributes)
-    // will be transferred to the client, so destructor does nothing
-    ~XmlTagInfo() {}
+    XmlTagInfo() : type(TAG_INVALID), name(NULL), attributesStart(0), attributesCount(0), rawAttributes(NULL) {}
     XmlTagType   type;
     char *       name;
-    Vec<char*> * attributes;
+    // attributes live in ParserState::attributes
+    size_t       attributesStart;
+    size_t       attributesCount;
+    // text of not yet split attributes if ParserState::lazyAttributes is set
+    char *       rawAttributes;
 };
 
+// Most of the time spent tokenizing is spent looking for the next character
+// of interest ('<', '>', '&', quote, newline), so we have an SSE2 version
+// that checks 16 bytes at a time. FindChar() returns a pointer to the first
+// occurrence of c1, c2, c3 or the terminating 0 in s. When looking for less
+// than 3 characters, repeat one of them.
+typedef char *(*FindCharProc)(char *s, char c1, char c2, char c3);
+
+static char *FindCharScalar(char *s, char c1, char c2, char c3)
+{
+    for (;;) {
+        char c = *s;
+        if (!c || c == c1 || c == c2 || c == c3)
+            return s;
+        ++s;
+    }
+}
+
+#if defined(_M_IX86) || defined(_M_X64)
+static inline int MatchMaskSse2(__m128i chunk, __m128i v1, __m128i v2, __m128i v3)
+{
+    __m128i m = _mm_cmpeq_epi8(chunk, _mm_setzero_si128());
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, v1));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, v2));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, v3));
+    return _mm_movemask_epi8(m);
+}
+
+static char *FindCharSse2(char *s, char c1, char c2, char c3)
+{
+    __m128i v1 = _mm_set1_epi8(c1);
+    __m128i v2 = _mm_set1_epi8(c2);
+    __m128i v3 = _mm_set1_epi8(c3);
+    // we only do aligned loads: they never cross a page boundary, so it's
+    // safe to read past the terminating 0. Bytes in the first chunk that
+    // are before s are shifted out of the mask.
+    size_t misalign = (size_t)s & 15;
+    char *p = s - misalign;
+    unsigned long mask = MatchMaskSse2(_mm_load_si128((__m128i*)p), v1, v2, v3) >> misalign;
+    unsigned long idx;
+    if (_BitScanForward(&idx, mask))
+        return s + idx;
+    for (;;) {
+        p += 16;
+        mask = MatchMaskSse2(_mm_load_si128((__m128i*)p), v1, v2, v3);
+        if (_BitScanForward(&idx, mask))
+            return p + idx;
+    }
+}
+
+static bool CpuHasSse2()
+{
+#if defined(_M_X64)
+    return true;
+#else
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#endif
+}
+
+static FindCharProc PickFindChar()
+{
+    return CpuHasSse2() ? FindCharSse2 : FindCharScalar;
+}
+#else
+static FindCharProc PickFindChar()
+{
+    return FindCharScalar;
+}
+#endif
+
+static FindCharProc gFindChar = PickFindChar();
+
+// for benchmarks: switches between the fastest kernel the cpu supports
+// and the scalar one. Returns false if the cpu only has the scalar one
+bool UseSimdMarkupScan(bool enable)
+{
+    FindCharProc fastest = PickFindChar();
+    gFindChar = enable ? fastest : FindCharScalar;
+    return fastest != FindCharScalar;
+}
+
+static inline char *FindChar(char *s, char c1, char c2, char c3)
+{
+    return gFindChar(s, c1, c2, c3);
+}
+
+// runs of whitespace and identifiers are short, so we don't bother
+// with SIMD there
 static void SkipWhitespace(char*& s)
 {
     while (*s && *s <= ' ')
@@ -96,16 +308,16 @@ static void ParseEntity(char*& s, char*& dst)
 
 static bool ParseXmlData(char*& s, char*& dst, char until)
 {
-    while (*s && *s != until)  {
-        if (*s == '&')  {
-            ParseEntity(++s, dst);
-        }
-        if (*s == ' ')  {
-            *dst++ = *s++;
-            //if (!m_bPreserveWhitespace)  SkipWhitespace(s);
-        } else {
-            *dst++ = *s++;
-        }
+    for (;;) {
+        char *e = FindChar(s, until, '&', '&');
+        // until we see the first entity, dst == s and there's nothing to copy
+        if (dst != s)
+            memmove(dst, s, e - s);
+        dst += e - s;
+        s = e;
+        if (*s != '&')
+            break;
+        ParseEntity(++s, dst);
     }
     // Make sure that MapAttributes() works correctly when it parses
     // over a value that has been transformed.
@@ -115,8 +327,9 @@ static bool ParseXmlData(char*& s, char*& dst, char until)
     return true;
 }
 
-static bool ParseAttributes(char* s, XmlTagInfo *tagInfo)
+static bool ParseAttributes(ParserState *state, char* s, XmlTagInfo *tagInfo)
 {
+    tagInfo->attributesStart = state->AttributesEnd();
     for (;;) {
         SkipWhitespace(s);
         if (!*s)
@@ -137,58 +350,212 @@ static bool ParseAttributes(char* s, XmlTagInfo *tagInfo)
             return false;
         *dst = '\0';
         *s++ = '\0';
-        if (!tagInfo->attributes)
-            tagInfo->attributes = new Vec<char*>();
-        tagInfo->attributes->Append(name);
-        tagInfo->attributes->Append(value);        
+        state->AppendAttribute(name, value);
+        tagInfo->attributesCount++;
     }
     return true;
 }
 
+// Splits the attributes of a node parsed with lazyAttributes. Malformed
+// attributes can't fail the parse at this point, the node only gets
+// the attributes before the error.
+void ParserState::DecodeAttributes(MarkupNode *node)
+{
+    XmlTagInfo tagInfo;
+    ParseAttributes(this, node->rawAttributes, &tagInfo);
+    node->attributesStart = tagInfo.attributesStart;
+    node->attributesCount = tagInfo.attributesCount;
+    node->rawAttributes = NULL;
+}
+
+// Template and Repeat are directives, not nodes:
+//   <Template name="row"> ... </Template>
+// defines nodes that can be repeated later by name, and
+//   <Repeat count="3" template="row" />  or  <Repeat count="3"> ... </Repeat>
+// reports the nodes of the template (or its own content) count times in
+// its place. The copies share the attributes of the nodes they were
+// made from, so neither the text nor the attributes are parsed again.
+static bool IsDirective(const char *name)
+{
+    return str::Eq(name, "Repeat") || str::Eq(name, "Template");
+}
+
+// adds a node for a tag that has just been parsed and reports it unless
+// it's part of a directive. Returns the index of the node
+int ParserState::AddNode(char *name, int parentIdx, size_t attributesStart, size_t attributesCount, char *rawAttributes)
+{
+    int idx;
+    MarkupNode *node = AllocNode(idx, parentIdx, attributesStart, attributesCount, rawAttributes);
+    node->name = name;
+    node->user = NULL;
+    if (-1 == directiveIdx && !IsDirective(name)) {
+        Report(idx);
+        return idx;
+    }
+    // a prototype can be copied many times, so we split its attributes
+    // now instead of once for every copy
+    if (rawAttributes)
+        DecodeAttributes(node);
+    if (-1 == directiveIdx)
+        directiveIdx = idx;
+    return idx;
+}
+
+// must be called when all children of a node have been added
+bool ParserState::CloseNode(int idx)
+{
+    MarkupNode *node = Node(idx);
+    if (str::Eq(node->name, "Template")) {
+        MarkupTemplate t;
+        t.name = node->GetAttribute("name");
+        if (!t.name)
+            return false;
+        t.start = idx + 1;
+        t.end = nodes.Count();
+        templates.Append(t);
+        if (idx == directiveIdx)
+            directiveIdx = -1;
+        return true;
+    }
+    // nested Repeat nodes are expanded with the outermost one
+    if (idx != directiveIdx || !str::Eq(node->name, "Repeat"))
+        return true;
+    directiveIdx = -1;
+    bool ok = ExpandRepeat(idx, nodes.Count(), node->parentIdx);
+    // nothing refers to the content of a Repeat once it's expanded,
+    // unless it defines a template
+    if (cb && (0 == templates.Count() || templates.Last().start < (size_t)idx))
+        nodes.RemoveAt(idx, nodes.Count() - idx);
+    return ok;
+}
+
+static MarkupTemplate *FindTemplate(Vec<MarkupTemplate>& templates, const char *name)
+{
+    for (size_t i = 0; i < templates.Count(); i++) {
+        if (str::Eq(templates.At(i).name, name))
+            return &templates.At(i);
+    }
+    return NULL;
+}
+
+// repeats the nodes of the Repeat node at repeatIdx, whose content
+// ends at end, as children of parentIdx
+bool ParserState::ExpandRepeat(int repeatIdx, size_t end, int parentIdx)
+{
+    MarkupNode *repeat = Node(repeatIdx);
+    const char *countStr = repeat->GetAttribute("count");
+    long count = countStr ? strtol(countStr, NULL, 10) : 1;
+    if (count < 0 || count > MAX_REPEAT_COUNT)
+        return false;
+    size_t start = repeatIdx + 1;
+    const char *name = repeat->GetAttribute("template");
+    if (name) {
+        MarkupTemplate *t = FindTemplate(templates, name);
+        if (!t)
+            return false;
+        start = t->start;
+        end = t->end;
+    }
+
+    if (repeatNesting >= MAX_REPEAT_NESTING)
+        return false;
+    repeatNesting++;
+    bool ok = true;
+    for (long i = 0; ok && i < count; i++) {
+        if (++expandedCount > MAX_EXPANDED_NODES) {
+            ok = false;
+            break;
+        }
+        size_t copyStart = nodes.Count();
+        ok = Expand(start, end, parentIdx);
+        // the nodes of a copy are only needed while it's being reported
+        if (cb)
+            nodes.RemoveAt(copyStart, nodes.Count() - copyStart);
+    }
+    repeatNesting--;
+    return ok;
+}
+
+// reports a copy of nodes [start, end) with nodes whose parent is
+// outside of the range becoming children of parentIdx
+bool ParserState::Expand(size_t start, size_t end, int parentIdx)
+{
+    // index of the copy of each node in the range
+    Vec<int> copies(end - start);
+    size_t i = start;
+    while (i < end) {
+        MarkupNode proto = nodes.At(i);
+        int parent = parentIdx;
+        if (proto.parentIdx >= (int)start)
+            parent = copies.At(proto.parentIdx - start);
+
+        if (++expandedCount > MAX_EXPANDED_NODES)
+            return false;
+
+        if (IsDirective(proto.name)) {
+            // nodes are in document order so the content of a node ends
+            // at the first node whose parent is before it
+            size_t contentEnd = i + 1;
+            while (contentEnd < end && nodes.At(contentEnd).parentIdx >= (int)i)
+                contentEnd++;
+            // templates are defined while parsing, copies don't define them again
+            if (str::Eq(proto.name, "Repeat") && !ExpandRepeat(i, contentEnd, parent))
+                return false;
+            for (; i < contentEnd; i++)
+                copies.Append(-1);
+            continue;
+        }
+
+        int idx;
+        MarkupNode *node = AllocNode(idx, parent, proto.attributesStart, proto.attributesCount);
+        node->name = proto.name;
+        node->user = NULL;
+        Report(idx);
+        copies.Append(idx);
+        i++;
+    }
+    return true;
+}
+
+// returns false if the comment or processing instruction isn't terminated
 static bool SkipCommentOrProcesingInstr(char *& s, bool& skipped)
 {
     skipped = false;
     if (!(*s == '!' || *s == '?'))
         return true;
     char end = (*s == '!') ? '-' : '?';
-    while (*s) {
-        if (*s == end) {
-            if (s[1] == '>')
-                goto Exit;
-            return false;
+    for (++s; *s; s++) {
+        if (*s == end && s[1] == '>') {
+            s += 2;
+            skipped = true;
+            return true;
         }
-        // TODO: this should be utf8-aware
-        s++;
     }
-Exit:
-    if (*s)
-        s += 2;
-    skipped = true;
-    return true;
+    return false;
 }
 
 // The xml variant used by directui allows unescaped '<' and '>' inside attribute
 // values, so as work-around, find closing '>' by looking for first unbalanced '>'
-char *FindTagClose(char *s)
+static char *FindTagClose(char *s)
 {
     int nest = 0;
-    while (*s) {
+    for (;;) {
+        s = FindChar(s, '<', '>', '>');
+        if (!*s)
+            return NULL;
         if (*s == '<')
             ++nest;
-        else if (*s == '>')
-        {
-            if (0 == nest)
-                return s;
+        else if (0 == nest)
+            return s;
+        else
             --nest;
-        }
         ++s;
     }
-    return NULL;
 }
 
 // parse xml tag information i.e. extract tag name and attributes
 // until closing '>'. We've already consumed opening '<' in the caller.
-static bool ParseTag(char *& s, XmlTagInfo& tagInfo)
+static bool ParseTag(ParserState *state, char *& s, XmlTagInfo& tagInfo)
 {
     tagInfo.type = TAG_OPEN;
     if (*s == '/') { // '</foo>
@@ -211,41 +578,39 @@ static bool ParseTag(char *& s, XmlTagInfo& tagInfo)
         tagInfo.type = TAG_OPEN_CLOSE;
         e[-1] = 0;
     }
-    if (NULL != tagInfo.attributes) {
-        delete tagInfo.attributes;
-        return false;
-    }
 
-    bool ok = ParseAttributes(tmp, &tagInfo);
+    bool ok = true;
+    if (state->lazyAttributes && TAG_CLOSE != tagInfo.type) {
+        // the name must be followed by whitespace or the end of the tag
+        if (*tmp > ' ')
+            return false;
+        tagInfo.rawAttributes = *tmp ? tmp + 1 : tmp;
+    } else {
+        ok = ParseAttributes(state, tmp, &tagInfo);
+    }
     *tmp = 0;
-    if (ok && (TAG_CLOSE == tagInfo.type) && tagInfo.attributes) {
-        delete tagInfo.attributes;
+    if (ok && (TAG_CLOSE == tagInfo.type) && tagInfo.attributesCount > 0)
         return false;
-    }
     return ok;
 }
 
-struct XmlNestingInfo {
-    char *  name;
-    int     nodeIdx;
-};
+static bool IsXmlComplete(ParserState *state)
+{
+    return -1 == state->xmlParentIdx && 0 == state->xmlStack.Count();
+}
 
-static bool ParseXml(ParserState *state)
+// parse the tags in s. s must only contain complete tags, but
+// they don't have to be balanced
+static bool ParseXmlTags(ParserState *state, char *s)
 {
-    Vec<XmlNestingInfo> stack;
-    int parentIdx = -1;
-    char *s = state->curr;
+    Vec<XmlNestingInfo>& stack = state->xmlStack;
+    int& parentIdx = state->xmlParentIdx;
     for (;;)
     {
         XmlTagInfo tagInfo;
         SkipWhitespace(s);
-        if (!*s) {
-            if (parentIdx != -1)
-                return false;
-            if (stack.Count() > 0)
-                return false;
+        if (!*s)
             return true;
-        }
 
         if (*s != '<')
             return false;
@@ -257,7 +622,7 @@ static bool ParseXml(ParserState *state)
         if (skipped)
             continue;
 
-        if (!ParseTag(s, tagInfo))
+        if (!ParseTag(state, s, tagInfo))
             return false;
 
         if (TAG_CLOSE == tagInfo.type) {
@@ -268,6 +633,8 @@ static bool ParseXml(ParserState *state)
             stack.RemoveAt(pos);
             if (!str::Eq(ni.name, tagInfo.name))
                 return false;
+            if (!state->CloseNode(ni.nodeIdx))
+                return false;
             parentIdx = -1;
             if (stack.Count() > 0) {
                 ni = stack.At(stack.Count() - 1);
@@ -276,13 +643,7 @@ static bool ParseXml(ParserState *state)
             continue;
         }
 
-        int nodeIdx;
-        MarkupNode *node = state->AllocNode(nodeIdx, parentIdx);
-        node->name = tagInfo.name;
-        node->attributes = tagInfo.attributes;
-        node->user = NULL;
-
-        state->cb->NewNode(node);
+        int nodeIdx = state->AddNode(tagInfo.name, parentIdx, tagInfo.attributesStart, tagInfo.attributesCount, tagInfo.rawAttributes);
 
         if (TAG_OPEN == tagInfo.type) {
             XmlNestingInfo ni;
@@ -290,19 +651,105 @@ static bool ParseXml(ParserState *state)
             ni.nodeIdx = nodeIdx;
             stack.Push(ni);
             parentIdx = nodeIdx;
+        } else if (!state->CloseNode(nodeIdx)) {
+            return false;
         }
 
     }
 }
 
+static bool ParseXml(ParserState *state)
+{
+    if (!ParseXmlTags(state, state->curr))
+        return false;
+    return IsXmlComplete(state);
+}
+
 bool ParseMarkupXml(const char *xml, MarkupParserCallback *cb)
 {
-    ParserState *state = new ParserState(xml, cb);
+    ParserState *state = new ParserState(str::Dup(xml), true, cb);
     bool ok = ParseXml(state);
     delete state;
     return ok;
 }
 
+// Like ParseMarkupXml() but doesn't make a copy of xml and parses it in place
+// instead. Names and values of nodes point inside xml so it must outlive
+// the callback (but not the parsing).
+bool ParseMarkupXmlInPlace(char *xml, MarkupParserCallback *cb)
+{
+    ParserState *state = new ParserState(xml, false, cb);
+    bool ok = ParseXml(state);
+    delete state;
+    return ok;
+}
+
+// returns the length of the prefix of s that only consists of complete
+// tags, comments and processing instructions (and whitespace between them)
+static size_t CompleteTagsLen(char *s)
+{
+    char *start = s;
+    char *end = s;
+    for (;;) {
+        SkipWhitespace(s);
+        if (!*s)
+            return end - start;
+        // malformed, let the parser report the error
+        if (*s != '<')
+            return str::Len(start);
+        char *e = s + 1;
+        if (*e == '!' || *e == '?') {
+            bool skipped;
+            if (!SkipCommentOrProcesingInstr(e, skipped))
+                return end - start;
+        } else {
+            e = FindTagClose(e);
+            if (!e)
+                return end - start;
+            ++e;
+        }
+        s = end = e;
+    }
+}
+
+MarkupXmlStreamParser::MarkupXmlStreamParser(MarkupParserCallback *cb) : ok(true)
+{
+    state = new ParserState(NULL, false, cb);
+}
+
+MarkupXmlStreamParser::~MarkupXmlStreamParser()
+{
+    delete state;
+}
+
+bool MarkupXmlStreamParser::Feed(const char *data, size_t len)
+{
+    if (!ok)
+        return false;
+    pending.Append(data, len);
+    size_t n = CompleteTagsLen(pending.Get());
+    if (0 == n)
+        return true;
+    // nodes point inside the text so each parsed block must stay
+    // alive until we're done
+    char *block = str::DupN(pending.Get(), n);
+    state->blocks.Append(block);
+    pending.RemoveAt(0, n);
+    ok = ParseXmlTags(state, block);
+    return ok;
+}
+
+bool MarkupXmlStreamParser::Finish()
+{
+    if (!ok)
+        return false;
+    char *s = pending.Get();
+    SkipWhitespace(s);
+    if (*s)
+        return false;
+    return IsXmlComplete(state);
+}
+
 static char* SkipSpaces(char *s)
 {
     while (*s == ' ')
@@ -317,8 +764,7 @@ static inline bool IsNewline(char c)
 
 static char *FindEndLine(char *s)
 {
-    while (*s && !IsNewline(*s))
-        ++s;
+    s = FindChar(s, '\n', '\r', '\r');
     if (!*s)
         return s;
     *s++ = 0;
@@ -343,6 +789,9 @@ static void SlashUnescape(char *s)
             } else if (s[1] == 'n') {
                 s += 2;
                 *dst++ = '\n';
+            } else {
+                // not an escape sequence, keep the backslash as is
+                *dst++ = *s++;
             }
         } else {
             *dst++ = *s++;
@@ -354,11 +803,11 @@ static void SlashUnescape(char *s)
 static char *FindQuotedEnd(char *s, int& len)
 {
     char *start = s;
+    len = 0;
     if (IsQuoteChar(*s)) {
         char c = *s++;
         char *res = s;
-        while (*s && *s != c)
-            ++s;
+        s = FindChar(s, c, c, c);
         if (!*s)
             return NULL;
         *s++ = 0;
@@ -366,22 +815,22 @@ static char *FindQuotedEnd(char *s, int& len)
         return res;
     }
 
-    while (*s && *s != ' ')
-        ++s;
+    s = FindChar(s, ' ', ' ', ' ');
     if (*s == ' ')
         *s++ = 0;
     len = s - start;
     return start;
 }
 
-static Vec<char*> *ParseAttributesSimple(char* s, bool& ok)
+// returns the number of attributes appended to state->attributes
+static size_t ParseAttributesSimple(ParserState *state, char* s, bool& ok)
 {
-    Vec<char*> *attributes = NULL;
+    size_t count = 0;
     while (*s)
     {
         SkipWhitespace(s);
         if (!*s)
-            return attributes;
+            return count;
         char *name = s;
         SkipIdentifier(s);
         if (*s != '=')
@@ -391,28 +840,26 @@ static Vec<char*> *ParseAttributesSimple(char* s, bool& ok)
         char *val = FindQuotedEnd(s, len);
         if (0 == len)
             goto Error;
-        if (NULL == attributes)
-            attributes = new Vec<char*>();
-        attributes->Append(name);
         SlashUnescape(val);
-        attributes->Append(val);
+        state->AppendAttribute(name, val);
+        count++;
         s += len;
     }
-    return attributes;
+    return count;
 Error:
     ok = false;
-    delete attributes;
-    return NULL;
+    return 0;
 }
 
 struct ParsedLine {
     int             indent;
     bool            isComment;
     char *          name;
-    Vec<char*> *    attributes;
+    size_t          attributesStart;
+    size_t          attributesCount;
 };
 
-static char *ParseSimpleLine(char *s, ParsedLine& p)
+static char *ParseSimpleLine(ParserState *state, char *s, ParsedLine& p)
 {
     char *e = FindEndLine(s);
     p.isComment = false;
@@ -430,8 +877,9 @@ static char *ParseSimpleLine(char *s, ParsedLine& p)
         else
             return NULL;
     }
-    bool ok;
-    p.attributes = ParseAttributesSimple(s, ok);
+    bool ok = true;
+    p.attributesStart = state->AttributesEnd();
+    p.attributesCount = ParseAttributesSimple(state, s, ok);
     if (!ok)
         return NULL;
     return e;
@@ -452,7 +900,7 @@ static bool ParseSimple(ParserState *state)
             break;
 
         ParsedLine p;
-        s = ParseSimpleLine(s, p);
+        s = ParseSimpleLine(state, s, p);
         if (!s)
             return false;
         if (p.isComment)
@@ -463,6 +911,8 @@ static bool ParseSimple(ParserState *state)
             NestingInfo it = stack.At(pos);
             if (it.indent >= p.indent) {
                 stack.RemoveAt(pos);
+                if (!state->CloseNode(it.nodeIdx))
+                    return false;
             } else {
                 parentNodeIdx = it.nodeIdx;
                 break;
@@ -472,12 +922,7 @@ static bool ParseSimple(ParserState *state)
         if (parentNodeIdx != -1 && 0 == stack.Count())
             return false;
 
-        int nodeIdx;
-        MarkupNode *node = state->AllocNode(nodeIdx, parentNodeIdx);
-        node->name = p.name;
-        node->attributes = p.attributes;
-        node->user = NULL;
-        state->cb->NewNode(node);
+        int nodeIdx = state->AddNode(p.name, parentNodeIdx, p.attributesStart, p.attributesCount);
 
         NestingInfo it;
         it.indent = p.indent;
@@ -485,14 +930,281 @@ static bool ParseSimple(ParserState *state)
         stack.Append(it);
     }
 
-    return 0 == stack.Count();
+    // nodes still on the stack are implicitly closed at the end of text
+    while (stack.Count() > 0) {
+        NestingInfo it = stack.Pop();
+        if (!state->CloseNode(it.nodeIdx))
+            return false;
+    }
+    return true;
 }
 
 bool ParseMarkupSimple(const char *s, MarkupParserCallback *cb)
 {
-    ParserState *state = new ParserState(s, cb);
+    ParserState *state = new ParserState(str::Dup(s), true, cb);
+    bool ok = ParseSimple(state);
+    delete state;
+    return ok;
+}
+
+// Like ParseMarkupSimple() but parses s in place, see ParseMarkupXmlInPlace()
+bool ParseMarkupSimpleInPlace(char *s, MarkupParserCallback *cb)
+{
+    ParserState *state = new ParserState(s, false, cb);
     bool ok = ParseSimple(state);
     delete state;
     return ok;
 }
 
+MarkupCursor::MarkupCursor() : state(NULL), curr((size_t)-1)
+{
+}
+
+MarkupCursor::~MarkupCursor()
+{
+    delete state;
+}
+
+bool MarkupCursor::Parse(char *s, bool isXml)
+{
+    delete state;
+    entries.Reset();
+    curr = (size_t)-1;
+    state = new ParserState(s, true, NULL);
+    bool ok = isXml ? ::ParseXml(state) : ::ParseSimple(state);
+    if (!ok) {
+        delete state;
+        state = NULL;
+        return false;
+    }
+
+    // the parent of a reported node is reported before it, so depth and
+    // position of the parent are known when we get to a node
+    Vec<int>& reported = state->reported;
+    Vec<int> positions;
+    positions.MakeSpaceAt(0, state->nodes.Count());
+    entries.EnsureCap(reported.Count());
+    for (size_t i = 0; i < reported.Count(); i++) {
+        int idx = reported.At(i);
+        positions.At(idx) = (int)i;
+        Entry e;
+        e.node = state->Node(idx);
+        e.parent = -1;
+        e.depth = 0;
+        if (e.node->parentIdx >= 0) {
+            e.parent = positions.At(e.node->parentIdx);
+            e.depth = entries.At(e.parent).depth + 1;
+        }
+        e.subtreeSize = 1;
+        entries.Append(e);
+    }
+    // going backwards, a subtree is complete when it's added to its parent
+    for (size_t i = entries.Count(); i > 0; i--) {
+        Entry& e = entries.At(i - 1);
+        if (e.parent >= 0)
+            entries.At(e.parent).subtreeSize += e.subtreeSize;
+    }
+    return true;
+}
+
+bool MarkupCursor::ParseXml(const char *xml)
+{
+    return Parse(str::Dup(xml), true);
+}
+
+bool MarkupCursor::ParseSimple(const char *s)
+{
+    return Parse(str::Dup(s), false);
+}
+
+// Compiled markup is a binary image of already parsed markup:
+//   CompiledMarkupHeader
+//   CompiledNode        nodes[nodesCount]
+//   CompiledAttribute   attributes[attributesCount]
+//   UINT32              names[namesCount]
+//   char                strings[stringsSize]
+// Attribute names are interned, names[] has the string offset for each
+// name id. Nodes are stored in the order they were parsed, so a parent
+// always comes before its children.
+
+#define COMPILED_MARKUP_MAGIC   "DUIM"
+#define COMPILED_MARKUP_VERSION 1
+
+struct CompiledMarkupHeader {
+    char    magic[4];
+    UINT32  version;
+    UINT32  nodesCount;
+    UINT32  attributesCount;
+    UINT32  namesCount;
+    UINT32  stringsSize;
+};
+
+struct CompiledNode {
+    INT32   parentIdx;
+    UINT32  name;
+    UINT32  attributesStart;
+    UINT32  attributesCount;
+};
+
+struct CompiledAttribute {
+    UINT32  nameId;
+    UINT32  value;
+};
+
+class MarkupCompiler : public MarkupParserCallback {
+    Vec<CompiledNode>       nodes;
+    Vec<CompiledAttribute>  attributes;
+    Vec<UINT32>             names;
+    str::Str<char>          strings;
+
+    UINT32 AddString(const char *s) {
+        UINT32 off = strings.Count();
+        strings.Append(s, str::Len(s) + 1);
+        return off;
+    }
+
+    UINT32 InternName(const char *name) {
+        for (size_t i = 0; i < names.Count(); i++) {
+            if (str::Eq(strings.Get() + names.At(i), name))
+                return i;
+        }
+        names.Append(AddString(name));
+        return names.Count() - 1;
+    }
+
+public:
+    virtual void NewNode(MarkupNode *node) {
+        CompiledNode n;
+        MarkupNode *parent = node->Parent();
+        // the user field of nodes we've seen is their index in nodes
+        n.parentIdx = parent ? (INT32)(size_t)parent->user : -1;
+        node->user = (void*)nodes.Count();
+        n.name = AddString(node->name);
+        n.attributesStart = attributes.Count();
+        n.attributesCount = node->AttributesCount();
+        for (size_t i = 0; i < n.attributesCount; i++) {
+            CompiledAttribute a;
+            a.nameId = InternName(node->AttributeName(i));
+            a.value = AddString(node->AttributeValue(i));
+            attributes.Append(a);
+        }
+        nodes.Append(n);
+    }
+
+    char *GetImage(size_t *lenOut) {
+        size_t nodesSize = nodes.Count() * sizeof(CompiledNode);
+        size_t attributesSize = attributes.Count() * sizeof(CompiledAttribute);
+        size_t namesSize = names.Count() * sizeof(UINT32);
+        size_t len = sizeof(CompiledMarkupHeader) + nodesSize + attributesSize + namesSize + strings.Count();
+        char *res = SAZA(char, len);
+        if (!res)
+            return NULL;
+        CompiledMarkupHeader *hdr = (CompiledMarkupHeader*)res;
+        memcpy(hdr->magic, COMPILED_MARKUP_MAGIC, sizeof(hdr->magic));
+        hdr->version = COMPILED_MARKUP_VERSION;
+        hdr->nodesCount = nodes.Count();
+        hdr->attributesCount = attributes.Count();
+        hdr->namesCount = names.Count();
+        hdr->stringsSize = strings.Count();
+        char *s = res + sizeof(CompiledMarkupHeader);
+        memcpy(s, nodes.LendData(), nodesSize);
+        s += nodesSize;
+        memcpy(s, attributes.LendData(), attributesSize);
+        s += attributesSize;
+        memcpy(s, names.LendData(), namesSize);
+        s += namesSize;
+        memcpy(s, strings.Get(), strings.Count());
+        *lenOut = len;
+        return res;
+    }
+};
+
+// Returns a malloc()ed image of compiled markup or NULL if xml
+// is not valid
+char *CompileMarkupXml(const char *xml, size_t *lenOut)
+{
+    MarkupCompiler compiler;
+    if (!ParseMarkupXml(xml, &compiler))
+        return NULL;
+    return compiler.GetImage(lenOut);
+}
+
+char *CompileMarkupSimple(const char *s, size_t *lenOut)
+{
+    MarkupCompiler compiler;
+    if (!ParseMarkupSimple(s, &compiler))
+        return NULL;
+    return compiler.GetImage(lenOut);
+}
+
+// Calls cb for every node of compiled markup, the same way parsing
+// the original text would. Node names and attribute values point
+// inside data, so it must stay valid until we return.
+bool ParseMarkupCompiled(const char *data, size_t len, MarkupParserCallback *cb)
+{
+    if (len < sizeof(CompiledMarkupHeader))
+        return false;
+    const CompiledMarkupHeader *hdr = (const CompiledMarkupHeader*)data;
+    if (memcmp(hdr->magic, COMPILED_MARKUP_MAGIC, sizeof(hdr->magic)) != 0)
+        return false;
+    if (hdr->version != COMPILED_MARKUP_VERSION)
+        return false;
+
+    // all counts are 32-bit so these can't overflow a 64-bit size_t, and on
+    // 32-bit the image would have to be bigger than the address space
+    ULONGLONG expectedLen = sizeof(CompiledMarkupHeader) +
+                            (ULONGLONG)hdr->nodesCount * sizeof(CompiledNode) +
+                            (ULONGLONG)hdr->attributesCount * sizeof(CompiledAttribute) +
+                            (ULONGLONG)hdr->namesCount * sizeof(UINT32) +
+                            hdr->stringsSize;
+    if (expectedLen != len)
+        return false;
+    const CompiledNode *nodes = (const CompiledNode*)(hdr + 1);
+    const CompiledAttribute *attributes = (const CompiledAttribute*)(nodes + hdr->nodesCount);
+    const UINT32 *names = (const UINT32*)(attributes + hdr->attributesCount);
+    const char *strings = (const char*)(names + hdr->namesCount);
+    UINT32 stringsSize = hdr->stringsSize;
+    // every string offset is checked against stringsSize, so a
+    // terminating 0 at the end guarantees all strings are terminated.
+    // An empty document has no strings and an empty string table
+    if (stringsSize > 0 && strings[stringsSize - 1] != 0)
+        return false;
+
+    for (UINT32 i = 0; i < hdr->namesCount; i++) {
+        if (names[i] >= stringsSize)
+            return false;
+    }
+    for (UINT32 i = 0; i < hdr->attributesCount; i++) {
+        if (attributes[i].nameId >= hdr->namesCount || attributes[i].value >= stringsSize)
+            return false;
+    }
+    for (UINT32 i = 0; i < hdr->nodesCount; i++) {
+        const CompiledNode& n = nodes[i];
+        if (n.parentIdx < -1 || n.parentIdx >= (INT32)i || n.name >= stringsSize)
+            return false;
+        if (n.attributesStart > hdr->attributesCount ||
+            n.attributesCount > hdr->attributesCount - n.attributesStart)
+            return false;
+    }
+
+    // the image is never modified, the casts are only needed because
+    // ParserState is shared with the text parsers
+    ParserState *state = new ParserState(NULL, false, cb);
+    state->attributes.EnsureCap(hdr->attributesCount * 2);
+    for (UINT32 i = 0; i < hdr->attributesCount; i++) {
+        char *name = (char*)strings + names[attributes[i].nameId];
+        state->AppendAttribute(name, (char*)strings + attributes[i].value);
+    }
+    state->nodes.EnsureCap(hdr->nodesCount);
+    for (UINT32 i = 0; i < hdr->nodesCount; i++) {
+        const CompiledNode& n = nodes[i];
+        int nodeIdx;
+        MarkupNode *node = state->AllocNode(nodeIdx, n.parentIdx, n.attributesStart, n.attributesCount);
+        node->name = (char*)strings + n.name;
+        node->user = NULL;
+        cb->NewNode(node);
+    }
+    delete state;
+    return true;
+}
+
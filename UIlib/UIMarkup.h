@@ -5,26 +5,121 @@
 #include "Vec.h"
 
 class ParserState;
+class MarkupCursor;
 
 class MarkupNode {
     friend ParserState;
+    friend MarkupCursor;
     int             parentIdx;
     ParserState *   parserState;
+    // attributes are kept in a single array owned by ParserState,
+    // a node only knows where its name/value pairs are in that array
+    size_t          attributesStart;
+    size_t          attributesCount;
+    // if not NULL, the text of the attributes which haven't been split
+    // yet, see MarkupParserCallback::WantsLazyAttributes()
+    char *          rawAttributes;
 public:
     const char *    name;
-    Vec<char*> *    attributes;
     void *          user;
 
     MarkupNode *    Parent();
+
+    size_t          AttributesCount() const;
+    const char *    AttributeName(size_t idx) const;
+    const char *    AttributeValue(size_t idx) const;
+    const char *    GetAttribute(const char *name) const;
 };
 
 class MarkupParserCallback
 {
 public:
     virtual void NewNode(MarkupNode *node) = 0;
+    // If true, the xml parser doesn't split the attributes of a tag until
+    // they're asked for, which is faster if many nodes are skipped. Such
+    // attributes are not validated, a malformed one silently ends the
+    // node's attribute list instead of failing the parse.
+    virtual bool WantsLazyAttributes() { return false; }
 };
 
+// Template and Repeat nodes are not reported, they're directives to
+// repeat other nodes, see IsDirective() in UIMarkup.cpp
 bool ParseMarkupXml(const char *xml, MarkupParserCallback *cb);
 bool ParseMarkupSimple(const char *s, MarkupParserCallback *cb);
 
+// zero-copy variants: they modify the caller-owned buffer while parsing
+bool ParseMarkupXmlInPlace(char *xml, MarkupParserCallback *cb);
+bool ParseMarkupSimpleInPlace(char *s, MarkupParserCallback *cb);
+
+// the parsers scan text with SSE2 when the cpu has it. Turning that off
+// is only useful to compare the two in benchmarks
+bool UseSimdMarkupScan(bool enable);
+
+// compiled markup is a binary image of parsed markup that can be
+// replayed without parsing any text. Compile* return a malloc()ed
+// image or NULL if the markup is malformed
+char *CompileMarkupXml(const char *xml, size_t *lenOut);
+char *CompileMarkupSimple(const char *s, size_t *lenOut);
+bool ParseMarkupCompiled(const char *data, size_t len, MarkupParserCallback *cb);
+
+// Pull-style alternative to MarkupParserCallback: the markup is parsed
+// up front and the nodes are then visited in document order, without a
+// virtual call per node. A whole subtree can be skipped in O(1).
+//   MarkupCursor c;
+//   if (c.ParseXml(xml)) while (c.Next()) { ... c.Name() ... }
+class MarkupCursor {
+    struct Entry {
+        MarkupNode *    node;
+        int             parent;
+        int             depth;
+        // number of nodes in the subtree, including the node itself
+        size_t          subtreeSize;
+    };
+
+    ParserState *   state;
+    Vec<Entry>      entries;
+    // (size_t)-1 before the first Next()
+    size_t          curr;
+
+    bool Parse(char *s, bool isXml);
+public:
+    MarkupCursor();
+    ~MarkupCursor();
+
+    // return false if the markup is malformed
+    bool ParseXml(const char *xml);
+    bool ParseSimple(const char *s);
+
+    // moves to the next node, returns false after the last one
+    bool Next() { return ++curr < entries.Count(); }
+    // the next call to Next() moves past the children of the current node
+    void SkipChildren() { curr += entries.At(curr).subtreeSize - 1; }
+
+    int          Depth() const { return entries.At(curr).depth; }
+    const char * Name() const { return entries.At(curr).node->name; }
+    size_t       AttrCount() const { return entries.At(curr).node->AttributesCount(); }
+    const char * AttrName(size_t idx) const { return entries.At(curr).node->AttributeName(idx); }
+    const char * Attr(size_t idx) const { return entries.At(curr).node->AttributeValue(idx); }
+    MarkupNode * Node() const { return entries.At(curr).node; }
+};
+
+// push-style xml parser for text that arrives in chunks (e.g. read from
+// a file or a socket). NewNode() is called as soon as a tag is complete,
+// without waiting for the rest of the document
+class MarkupXmlStreamParser {
+    ParserState *   state;
+    // text of the incomplete tag at the end of the data fed so far
+    str::Str<char>  pending;
+    bool            ok;
+
+public:
+    MarkupXmlStreamParser(MarkupParserCallback *cb);
+    ~MarkupXmlStreamParser();
+
+    // returns false as soon as the xml is known to be malformed
+    bool Feed(const char *data, size_t len);
+    // returns false if the xml was malformed or incomplete
+    bool Finish();
+};
+
 #endif
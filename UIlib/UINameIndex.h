@@ -0,0 +1,116 @@
+#ifndef UINameIndex_h
+#define UINameIndex_h
+
+#include "BaseUtil.h"
+#include "StrUtil.h"
+
+// Objects hashed by their name, for PaintManagerUI::FindControl(name).
+// The lists of the buckets are linked through the objects themselves
+// (T::m_nameNext and T::m_namePrev), so adding and removing one takes
+// constant time and doesn't allocate. A list is kept in the order the
+// objects were added: of several objects with the same name, Find()
+// returns the one added first. The first object's m_namePrev is the last
+// one of its list, so that appending doesn't walk the list.
+// The table doubles when it holds as many objects as buckets.
+template <class T>
+class NameIndex {
+    T **    buckets;
+    size_t  bucketsCount;
+    size_t  count;
+
+    static UINT Hash(const char *name) {
+        UINT i = 0;
+        while (*name) {
+            i = (i << 5) + i + *name++;
+        }
+        return i;
+    }
+
+    T **Bucket(T **table, size_t tableCount, const char *name) const {
+        return &table[Hash(name) & (tableCount - 1)];
+    }
+
+    static void Append(T **bucket, T *obj) {
+        T *first = *bucket;
+        obj->m_nameNext = NULL;
+        if (first == NULL) {
+            obj->m_namePrev = obj;
+            *bucket = obj;
+        } else {
+            obj->m_namePrev = first->m_namePrev;
+            first->m_namePrev->m_nameNext = obj;
+            first->m_namePrev = obj;
+        }
+    }
+
+    bool Grow() {
+        size_t newCount = bucketsCount ? bucketsCount * 2 : 64;
+        T **newBuckets = SAZA(T *, newCount);
+        if (!newBuckets)
+            return false;
+        // the objects of a list stay in the same order
+        for (size_t i = 0; i < bucketsCount; i++) {
+            T *obj = buckets[i];
+            while (obj) {
+                T *next = obj->m_nameNext;
+                Append(Bucket(newBuckets, newCount, obj->m_name), obj);
+                obj = next;
+            }
+        }
+        free(buckets);
+        buckets = newBuckets;
+        bucketsCount = newCount;
+        return true;
+    }
+
+public:
+    NameIndex() : buckets(NULL), bucketsCount(0), count(0) { }
+    ~NameIndex() { free(buckets); }
+
+    // objects without a name or already in the index are ignored
+    void Add(T *obj) {
+        if (obj->m_nameIndexed || !obj->m_name)
+            return;
+        if (count >= bucketsCount && !Grow() && !buckets)
+            return;
+        Append(Bucket(buckets, bucketsCount, obj->m_name), obj);
+        obj->m_nameIndexed = true;
+        count++;
+    }
+
+    // must be called before the object's name changes
+    void Remove(T *obj) {
+        if (!obj->m_nameIndexed)
+            return;
+        T **bucket = Bucket(buckets, bucketsCount, obj->m_name);
+        T *first = *bucket;
+        if (obj == first) {
+            *bucket = obj->m_nameNext;
+            if (obj->m_nameNext)
+                obj->m_nameNext->m_namePrev = obj->m_namePrev;
+        } else {
+            obj->m_namePrev->m_nameNext = obj->m_nameNext;
+            if (obj->m_nameNext)
+                obj->m_nameNext->m_namePrev = obj->m_namePrev;
+            else
+                first->m_namePrev = obj->m_namePrev;
+        }
+        obj->m_nameNext = obj->m_namePrev = NULL;
+        obj->m_nameIndexed = false;
+        count--;
+    }
+
+    T *Find(const char *name) const {
+        if (!buckets)
+            return NULL;
+        for (T *obj = *Bucket(buckets, bucketsCount, name); obj; obj = obj->m_nameNext) {
+            if (str::Eq(obj->m_name, name))
+                return obj;
+        }
+        return NULL;
+    }
+
+    size_t Count() const { return count; }
+};
+
+#endif
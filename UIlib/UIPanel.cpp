@@ -57,6 +57,13 @@ bool NavigatorPanelUI::Add(ControlUI* ctrl)
     return ContainerUI::Add(ctrl);
 }
 
+// items know their index so they can only be appended
+bool NavigatorPanelUI::AddAt(ControlUI* ctrl, int idx)
+{
+    if (idx != GetCount())  return false;
+    return Add(ctrl);
+}
+
 SIZE NavigatorPanelUI::EstimateSize(SIZE szAvailable)
 {
     return CSize(0, 0);
@@ -293,10 +300,10 @@ void SearchTitlePanelUI::DoPaint(HDC hDC, const RECT& rcPaint)
     HorizontalLayoutUI::DoPaint(hDC, rcPaint);
 }
 
-void SearchTitlePanelUI::SetAttribute(const char* name, const char* value)
+void SearchTitlePanelUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "image"))  SetImage(atoi(value));
-    else HorizontalLayoutUI::SetAttribute(name, value);
+    if (ATTR_IMAGE == id)  SetImage(atoi(value));
+    else HorizontalLayoutUI::ApplyAttribute(id, name, value);
 }
 
 
@@ -323,14 +330,15 @@ void PaddingPanelUI::SetHeight(int cyHeight)
     UpdateLayout();
 }
 
-void PaddingPanelUI::SetAttribute(const char* name, const char* value)
+void PaddingPanelUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else if (ParseHeight(name, value, n))
-        SetHeight(n);
-    else ControlUI::SetAttribute(name, value);
+    switch (id) {
+    case ATTR_WIDTH:
+    case ATTR_DX:     SetWidth(atoi(value)); break;
+    case ATTR_HEIGHT:
+    case ATTR_DY:     SetHeight(atoi(value)); break;
+    default:          ControlUI::ApplyAttribute(id, name, value);
+    }
 }
 
 const char* PaddingPanelUI::GetClass() const
@@ -383,15 +391,16 @@ void ImagePanelUI::SetHeight(int cyHeight)
     UpdateLayout();
 }
 
-void ImagePanelUI::SetAttribute(const char* name, const char* value)
+void ImagePanelUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    int n;
-    if (ParseWidth(name, value, n))
-        SetWidth(n);
-    else if (ParseHeight(name, value, n))
-        SetHeight(n);
-    else if (str::Eq(name, "image"))  SetImage(value);
-    else ControlUI::SetAttribute(name, value);
+    switch (id) {
+    case ATTR_WIDTH:
+    case ATTR_DX:     SetWidth(atoi(value)); break;
+    case ATTR_HEIGHT:
+    case ATTR_DY:     SetHeight(atoi(value)); break;
+    case ATTR_IMAGE:  SetImage(value); break;
+    default:          ControlUI::ApplyAttribute(id, name, value);
+    }
 }
 
 const char* ImagePanelUI::GetClass() const
@@ -478,11 +487,11 @@ void TextPanelUI::Event(TEventUI& event)
     LabelPanelUI::Event(event);
 }
 
-void TextPanelUI::SetAttribute(const char* name, const char* value)
+void TextPanelUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "textColor"))  SetTextColor((UITYPE_COLOR)atoi(value));
-    else if (str::Eq(name, "backColor"))  SetBkColor((UITYPE_COLOR)atoi(value));
-    else LabelPanelUI::SetAttribute(name, value);
+    if (ATTR_TEXTCOLOR == id)  SetTextColor((UITYPE_COLOR)atoi(value));
+    else if (ATTR_BACKCOLOR == id)  SetBkColor((UITYPE_COLOR)atoi(value));
+    else LabelPanelUI::ApplyAttribute(id, name, value);
 }
 
 SIZE TextPanelUI::EstimateSize(SIZE szAvailable)
@@ -524,13 +533,13 @@ void WarningPanelUI::SetWarningType(UINT uType)
     }
 }
 
-void WarningPanelUI::SetAttribute(const char* name, const char* value)
+void WarningPanelUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "type"))  {
+    if (ATTR_TYPE == id)  {
         if (str::Eq(value, "error"))  SetWarningType(MB_ICONERROR);
         if (str::Eq(value, "warning"))  SetWarningType(MB_ICONWARNING);
     }
-    else TextPanelUI::SetAttribute(name, value);
+    else TextPanelUI::ApplyAttribute(id, name, value);
 }
 
 SIZE WarningPanelUI::EstimateSize(SIZE szAvailable)
@@ -34,6 +34,7 @@ public:
     void* GetInterface(const char* name);
 
     bool Add(ControlUI* ctrl);
+    bool AddAt(ControlUI* ctrl, int idx);
 
     virtual int GetCurSel() const;
     virtual bool SelectItem(int idx);
@@ -76,7 +77,7 @@ public:
 
     virtual void SetPos(RECT rc);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     int m_iconIdx;
@@ -95,7 +96,7 @@ public:
 
     virtual SIZE EstimateSize(SIZE szAvailable);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     SIZE m_cxyFixed;
@@ -115,7 +116,7 @@ public:
 
     virtual SIZE EstimateSize(SIZE szAvailable);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     HBITMAP m_hBitmap;
@@ -139,7 +140,7 @@ public:
     virtual SIZE EstimateSize(SIZE szAvailable);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
 
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     int          m_nLinks;
@@ -160,7 +161,7 @@ public:
 
     virtual SIZE EstimateSize(SIZE szAvailable);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);  
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     UITYPE_COLOR m_backColor;
@@ -0,0 +1,119 @@
+#include "UIStringPool.h"
+#include "StrUtil.h"
+#include <stddef.h>
+
+struct StringPool::Entry {
+    Entry *     next;
+    UINT32      hash;
+    UINT32      refs;
+    size_t      len;
+    // the string itself, len + 1 bytes
+    char        s[1];
+};
+
+#define ENTRY_FROM_STRING(s) ((Entry *)((char *)(s) - offsetof(Entry, s)))
+
+StringPool::StringPool() :
+    buckets(NULL), bucketsCount(0), count(0), referencedBytes(0), allocatedBytes(0)
+{
+}
+
+StringPool::~StringPool()
+{
+    for (size_t i = 0; i < bucketsCount; i++) {
+        Entry *e = buckets[i];
+        while (e) {
+            Entry *next = e->next;
+            free(e);
+            e = next;
+        }
+    }
+    free(buckets);
+}
+
+void StringPool::Grow()
+{
+    size_t newCount = bucketsCount ? bucketsCount * 2 : 256;
+    Entry **newBuckets = SAZA(Entry *, newCount);
+    if (!newBuckets)
+        return;
+    for (size_t i = 0; i < bucketsCount; i++) {
+        Entry *e = buckets[i];
+        while (e) {
+            Entry *next = e->next;
+            size_t idx = e->hash & (newCount - 1);
+            e->next = newBuckets[idx];
+            newBuckets[idx] = e;
+            e = next;
+        }
+    }
+    free(buckets);
+    buckets = newBuckets;
+    bucketsCount = newCount;
+}
+
+const char *StringPool::Intern(const char *s)
+{
+    if (!s)
+        return NULL;
+    if (count >= bucketsCount)
+        Grow();
+    if (!buckets)
+        return NULL;
+
+    size_t len;
+    UINT32 hash = str::Hash(s, &len);
+    Entry **bucket = &buckets[hash & (bucketsCount - 1)];
+    for (Entry *e = *bucket; e; e = e->next) {
+        if (e->hash == hash && e->len == len && str::Eq(e->s, s)) {
+            e->refs++;
+            referencedBytes += len + 1;
+            return e->s;
+        }
+    }
+
+    Entry *e = (Entry *)malloc(offsetof(Entry, s) + len + 1);
+    if (!e)
+        return NULL;
+    memcpy(e->s, s, len + 1);
+    e->hash = hash;
+    e->refs = 1;
+    e->len = len;
+    e->next = *bucket;
+    *bucket = e;
+    count++;
+    referencedBytes += len + 1;
+    allocatedBytes += offsetof(Entry, s) + len + 1;
+    return e->s;
+}
+
+void StringPool::Release(const char *s)
+{
+    if (!s)
+        return;
+    Entry *e = ENTRY_FROM_STRING(s);
+    referencedBytes -= e->len + 1;
+    if (--e->refs > 0)
+        return;
+
+    Entry **prev = &buckets[e->hash & (bucketsCount - 1)];
+    while (*prev != e)
+        prev = &(*prev)->next;
+    *prev = e->next;
+    count--;
+    allocatedBytes -= offsetof(Entry, s) + e->len + 1;
+    free(e);
+}
+
+void StringPool::Replace(const char*& s, const char *replacement)
+{
+    // interning first keeps s alive if it's the same string
+    const char *old = s;
+    s = Intern(replacement);
+    Release(old);
+}
+
+size_t StringPool::AllocatedBytes() const
+{
+    return allocatedBytes + bucketsCount * sizeof(Entry *);
+}
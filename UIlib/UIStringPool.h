@@ -0,0 +1,38 @@
+#ifndef UIStringPool_h
+#define UIStringPool_h
+
+#include "BaseUtil.h"
+
+// Keeps a single refcounted copy of each distinct string. A string is
+// added with Intern() and every Intern() must be matched by a Release().
+// Pooled strings are immutable and two of them are equal if and only if
+// they are the same pointer.
+class StringPool {
+    struct Entry;
+
+    Entry **    buckets;
+    // always a power of 2
+    size_t      bucketsCount;
+    size_t      count;
+    size_t      referencedBytes;
+    size_t      allocatedBytes;
+
+    void Grow();
+public:
+    StringPool();
+    ~StringPool();
+
+    // returns NULL for NULL
+    const char *Intern(const char *s);
+    void Release(const char *s);
+    // like str::Replace() for a pooled s
+    void Replace(const char*& s, const char *replacement);
+
+    size_t Count() const { return count; }
+    // the memory the strings would take if each reference had its own copy
+    size_t ReferencedBytes() const { return referencedBytes; }
+    // the memory the pool actually takes
+    size_t AllocatedBytes() const;
+};
+
+#endif
@@ -23,6 +23,13 @@ bool TabFolderUI::Add(ControlUI* ctrl)
     return ContainerUI::Add(ctrl);
 }
 
+// inserting would change the index of the selected page
+bool TabFolderUI::AddAt(ControlUI* ctrl, int idx)
+{
+    if (idx != GetCount())  return false;
+    return Add(ctrl);
+}
+
 int TabFolderUI::GetCurSel() const
 {
     return m_curSel;
@@ -126,13 +133,13 @@ void TabFolderUI::DoPaint(HDC hDC, const RECT& rcPaint)
         }
     }
 
-    if (m_curPage != NULL)  m_curPage->DoPaint(hDC, rcPaint);
+    if (m_curPage != NULL)  m_mgr->PaintControl(m_curPage, hDC, rcPaint);
 }
 
-void TabFolderUI::SetAttribute(const char* name, const char* value)
+void TabFolderUI::ApplyAttribute(AttrId id, const char* name, const char* value)
 {
-    if (str::Eq(name, "select"))  SelectItem(atoi(value));
-    else ContainerUI::SetAttribute(name, value);
+    if (ATTR_SELECT == id)  SelectItem(atoi(value));
+    else ContainerUI::ApplyAttribute(id, name, value);
 }
 
 TabPageUI::TabPageUI()
@@ -13,6 +13,7 @@ public:
     void Init();
 
     bool Add(ControlUI* ctrl);
+    bool AddAt(ControlUI* ctrl, int idx);
 
     int GetCurSel() const;
     bool SelectItem(int idx);
@@ -21,7 +22,7 @@ public:
 
     virtual void SetPos(RECT rc);
     virtual void DoPaint(HDC hDC, const RECT& rcPaint);
-    virtual void SetAttribute(const char* name, const char* value);
+    virtual void ApplyAttribute(AttrId id, const char* name, const char* value);
 
 protected:
     int         m_curSel;
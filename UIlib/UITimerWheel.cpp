@@ -0,0 +1,232 @@
+#include "UITimerWheel.h"
+
+// one list per ms. Most UI timers fire more often than once a second and
+// so are due the first time their list is looked at
+#define WHEEL_SLOTS     1024
+#define WHEEL_MASK      (WHEEL_SLOTS - 1)
+#define DUE_LIST        WHEEL_SLOTS
+#define NO_TIMER        ((UINT)-1)
+
+// a is before or at b, even if the time wrapped around in between
+static bool NotAfter(UINT a, UINT b)
+{
+    return (int)(a - b) <= 0;
+}
+
+TimerWheel::TimerWheel(UINT now) : freeList(NO_TIMER), buckets(NULL), bucketsCount(0), count(0), current(now)
+{
+    lists = (UINT *)malloc((WHEEL_SLOTS + 1) * sizeof(UINT));
+    if (lists)
+        memset(lists, 0xff, (WHEEL_SLOTS + 1) * sizeof(UINT));
+}
+
+TimerWheel::~TimerWheel()
+{
+    free(lists);
+    free(buckets);
+}
+
+// the timers of a control are all in the same bucket, see KillAll()
+UINT *TimerWheel::Bucket(ControlUI *ctrl) const
+{
+    UINT h = (UINT)((UINT_PTR)ctrl >> 4);
+    h = (h ^ (h >> 16)) * 0x45d9f3b;
+    h ^= h >> 16;
+    return &buckets[h & (bucketsCount - 1)];
+}
+
+UINT TimerWheel::Find(ControlUI *ctrl, UINT id) const
+{
+    if (0 == bucketsCount)
+        return NO_TIMER;
+    UINT idx = *Bucket(ctrl);
+    while (idx != NO_TIMER) {
+        const Timer& timer = timers.At(idx);
+        if (timer.ctrl == ctrl && timer.id == id)
+            return idx;
+        idx = timer.hashNext;
+    }
+    return NO_TIMER;
+}
+
+// keeps the buckets at least as many as the timers
+bool TimerWheel::GrowBuckets()
+{
+    size_t newCount = bucketsCount ? bucketsCount * 2 : 64;
+    UINT *newBuckets = (UINT *)malloc(newCount * sizeof(UINT));
+    if (!newBuckets)
+        return false;
+    free(buckets);
+    buckets = newBuckets;
+    bucketsCount = newCount;
+    memset(buckets, 0xff, bucketsCount * sizeof(UINT));
+    for (size_t i = 0; i < timers.Count(); i++) {
+        Timer& timer = timers.At(i);
+        if (NO_TIMER == timer.list)
+            continue;
+        UINT *bucket = Bucket(timer.ctrl);
+        timer.hashNext = *bucket;
+        *bucket = (UINT)i;
+    }
+    return true;
+}
+
+void TimerWheel::Link(UINT idx, UINT list)
+{
+    Timer& timer = timers.At(idx);
+    timer.list = list;
+    timer.prev = NO_TIMER;
+    timer.next = lists[list];
+    if (timer.next != NO_TIMER)
+        timers.At(timer.next).prev = idx;
+    lists[list] = idx;
+}
+
+void TimerWheel::Unlink(UINT idx)
+{
+    Timer& timer = timers.At(idx);
+    if (timer.prev != NO_TIMER)
+        timers.At(timer.prev).next = timer.next;
+    else
+        lists[timer.list] = timer.next;
+    if (timer.next != NO_TIMER)
+        timers.At(timer.next).prev = timer.prev;
+}
+
+bool TimerWheel::Set(ControlUI *ctrl, UINT id, UINT interval, UINT now)
+{
+    if (!lists)
+        return false;
+    // a timer due by the time Advance() was last called would otherwise
+    // wait for the wheel to come around
+    UINT due = now + max(interval, 1U);
+    if (NotAfter(due, current))
+        due = current + 1;
+
+    UINT idx = Find(ctrl, id);
+    if (idx != NO_TIMER) {
+        Unlink(idx);
+    } else {
+        if (count >= bucketsCount && !GrowBuckets())
+            return false;
+        if (freeList != NO_TIMER) {
+            idx = freeList;
+            freeList = timers.At(idx).next;
+        } else {
+            Timer empty = { 0 };
+            timers.Append(empty);
+            idx = (UINT)timers.Count() - 1;
+        }
+        Timer& timer = timers.At(idx);
+        timer.ctrl = ctrl;
+        timer.id = id;
+        UINT *bucket = Bucket(ctrl);
+        timer.hashNext = *bucket;
+        *bucket = idx;
+        count++;
+    }
+    Timer& timer = timers.At(idx);
+    timer.interval = max(interval, 1U);
+    timer.due = due;
+    Link(idx, due & WHEEL_MASK);
+    return true;
+}
+
+// the timer must already be removed from its bucket
+void TimerWheel::Free(UINT idx)
+{
+    Unlink(idx);
+    Timer& timer = timers.At(idx);
+    timer.list = NO_TIMER;
+    timer.next = freeList;
+    freeList = idx;
+    count--;
+}
+
+bool TimerWheel::Kill(ControlUI *ctrl, UINT id)
+{
+    if (0 == bucketsCount)
+        return false;
+    UINT *link = Bucket(ctrl);
+    while (*link != NO_TIMER) {
+        UINT idx = *link;
+        Timer& timer = timers.At(idx);
+        if (timer.ctrl == ctrl && timer.id == id) {
+            *link = timer.hashNext;
+            Free(idx);
+            return true;
+        }
+        link = &timer.hashNext;
+    }
+    return false;
+}
+
+void TimerWheel::KillAll(ControlUI *ctrl)
+{
+    if (0 == bucketsCount)
+        return;
+    UINT *link = Bucket(ctrl);
+    while (*link != NO_TIMER) {
+        UINT idx = *link;
+        Timer& timer = timers.At(idx);
+        if (timer.ctrl == ctrl) {
+            *link = timer.hashNext;
+            Free(idx);
+        } else {
+            link = &timer.hashNext;
+        }
+    }
+}
+
+void TimerWheel::Advance(UINT now, FireProc fire, void *data)
+{
+    if (!lists)
+        return;
+    if (!NotAfter(now, current)) {
+        UINT elapsed = min(now - current, (UINT)WHEEL_SLOTS);
+        for (UINT i = 1; i <= elapsed; i++) {
+            UINT idx = lists[(current + i) & WHEEL_MASK];
+            while (idx != NO_TIMER) {
+                UINT next = timers.At(idx).next;
+                if (NotAfter(timers.At(idx).due, now)) {
+                    Unlink(idx);
+                    Link(idx, DUE_LIST);
+                }
+                idx = next;
+            }
+        }
+        current = now;
+    }
+    // timers are only taken off the due list right before they fire, so
+    // that fire can still kill them
+    while (lists[DUE_LIST] != NO_TIMER) {
+        UINT idx = lists[DUE_LIST];
+        Timer& timer = timers.At(idx);
+        ControlUI *ctrl = timer.ctrl;
+        UINT id = timer.id;
+        timer.due = current + timer.interval;
+        Unlink(idx);
+        Link(idx, timer.due & WHEEL_MASK);
+        fire(ctrl, id, data);
+    }
+}
+
+bool TimerWheel::NextDue(UINT now, UINT *delay) const
+{
+    if (0 == count)
+        return false;
+    *delay = 0;
+    if (lists[DUE_LIST] != NO_TIMER)
+        return true;
+    // the first list after current that isn't empty. Its timers may be
+    // due rounds later, then Advance() is just called early
+    for (UINT i = 1; i <= WHEEL_SLOTS; i++) {
+        if (lists[(current + i) & WHEEL_MASK] != NO_TIMER) {
+            int untilDue = (int)(current + i - now);
+            if (untilDue > 0)
+                *delay = untilDue;
+            return true;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef UITimerWheel_h
+#define UITimerWheel_h
+
+#include "BaseUtil.h"
+#include "Vec.h"
+
+class ControlUI;
+
+// The timers of all controls of a window, so that they can share a single
+// OS timer. Like those of SetTimer(), a timer fires every interval ms
+// until it's killed and a timer that's late fires once, not once for each
+// interval missed. Times are in ms as returned by GetTickCount() and may
+// wrap around.
+// Timers are hashed by the time they're due into a list per ms of the
+// wheel. Those due further away than the wheel is long stay in their list
+// for more rounds. Setting, killing and firing a timer take constant
+// time, Advance() also looks at each ms since it was last called.
+class TimerWheel {
+public:
+    typedef void (*FireProc)(ControlUI *ctrl, UINT id, void *data);
+
+private:
+    struct Timer {
+        ControlUI * ctrl;
+        UINT        id;
+        UINT        interval;
+        UINT        due;
+        // the list the timer is in, see lists. Free timers have no list
+        // and are linked through next
+        UINT        list;
+        UINT        next;
+        UINT        prev;
+        // the next timer in the same bucket
+        UINT        hashNext;
+    };
+
+    Vec<Timer>  timers;
+    UINT        freeList;
+    // the heads of the wheel's lists, followed by the list of timers that
+    // are due but haven't fired yet
+    UINT *      lists;
+    // ctrl to its timers, linked through hashNext
+    UINT *      buckets;
+    size_t      bucketsCount;
+    size_t      count;
+    // the time Advance() was last called with
+    UINT        current;
+
+    UINT Find(ControlUI *ctrl, UINT id) const;
+    UINT *Bucket(ControlUI *ctrl) const;
+    void Link(UINT idx, UINT list);
+    void Unlink(UINT idx);
+    void Free(UINT idx);
+    bool GrowBuckets();
+public:
+    explicit TimerWheel(UINT now=0);
+    ~TimerWheel();
+
+    // setting a timer that exists already restarts it with the new interval
+    bool Set(ControlUI *ctrl, UINT id, UINT interval, UINT now);
+    bool Kill(ControlUI *ctrl, UINT id);
+    // kills the timers of a control that's being deleted
+    void KillAll(ControlUI *ctrl);
+    // calls fire for each timer due by now. fire may set and kill timers
+    void Advance(UINT now, FireProc fire, void *data);
+    // the ms from now until the first timer that might be due, which is
+    // when Advance() has to be called next. Returns false if there are
+    // no timers
+    bool NextDue(UINT now, UINT *delay) const;
+
+    size_t Count() const { return count; }
+};
+
+#endif
@@ -19,6 +19,13 @@
 #include <ctype.h>
 
 #include "UIBase.h"
+#include "UIArena.h"
+#include "UIStringPool.h"
+#include "UIHitTest.h"
+#include "UIDirtyRegion.h"
+#include "UILayerCache.h"
+#include "UITimerWheel.h"
+#include "UINameIndex.h"
 #include "UIAnim.h"
 #include "UIManager.h"
 #include "UIBlue.h"
@@ -35,5 +42,6 @@
 #include "UIDecoration.h"
 
 #include "UIMarkup.h"
+#include "UIFactory.h"
 #include "UIDlgBuilder.h"
 
@@ -228,6 +228,42 @@ FILETIME GetModificationTime(const char *filePathUtf8)
     return lastMod;
 }
 
+// Maps the whole file into memory as read-only. Returns NULL on failure
+// (mapping an empty file fails as well).
+// The caller must release the data with file::Unmap()
+const char *MapReadOnly(const char *filePathUtf8, size_t *fileSizeOut)
+{
+    HANDLE h = CreateFileUtf8(filePathUtf8, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,  NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    DWORD sizeHigh = 0;
+    DWORD size = GetFileSize(h, &sizeHigh);
+    HANDLE mapping = NULL;
+    if (INVALID_FILE_SIZE != size && 0 == sizeHigh && size > 0)
+        mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(h);
+    if (!mapping)
+        return NULL;
+
+    // the view keeps the mapping alive after the handle is closed
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        return NULL;
+
+    if (fileSizeOut)
+        *fileSizeOut = size;
+    return (const char *)data;
+}
+
+void Unmap(const char *data)
+{
+    if (data)
+        UnmapViewOfFile(data);
+}
+
 }
 
 namespace dir {
@@ -24,6 +24,8 @@ bool         WriteAll(const char *filePath, void *data, size_t dataLen);
 size_t       GetSize(const char *filePath);
 bool         Delete(const char *filePath);
 FILETIME     GetModificationTime(const char *filePath);
+const char * MapReadOnly(const char *filePath, size_t *fileSizeOut);
+void         Unmap(const char *data);
 
 }
 
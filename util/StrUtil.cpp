@@ -47,6 +47,19 @@ const char *Find(const char *s, const char *subs)
     return strstr(s, subs);
 }
 
+UINT32 Hash(const char *s, size_t *lenOut)
+{
+    UINT32 hash = 2166136261;
+    const char *start = s;
+    for (; *s; s++) {
+        hash ^= (BYTE)*s;
+        hash *= 16777619;
+    }
+    if (lenOut)
+        *lenOut = s - start;
+    return hash;
+}
+
 char *FmtV(const char *fmt, va_list args)
 {
     char    message[256];
@@ -21,6 +21,10 @@ inline bool EqN(const char *s1, const char *s2, size_t len) {
 
 const char *Find(const char *s, const char *subs);
 
+// FNV-1a, for hash tables keyed by string. If lenOut isn't NULL, it
+// receives the length of s
+UINT32      Hash(const char *s, size_t *lenOut=NULL);
+
 char *  FmtV(const char *fmt, va_list args);
 char *  Format(const char *fmt, ...);
 